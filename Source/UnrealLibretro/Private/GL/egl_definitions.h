@@ -0,0 +1,81 @@
+#pragma once
+
+// The subset of EGL we use on Linux. We load libEGL.so.1 at runtime rather than link against it so machines without it can still run software rendered cores,
+// and the sysroot Unreal's Linux toolchain ships doesn't include EGL headers anyway. Values are from the Khronos registry https://registry.khronos.org/EGL/api/EGL/egl.h
+
+#include <stdint.h>
+
+typedef unsigned int EGLBoolean;
+typedef unsigned int EGLenum;
+typedef int32_t      EGLint;
+typedef intptr_t     EGLAttrib;
+typedef void*        EGLConfig;
+typedef void*        EGLContext;
+typedef void*        EGLDisplay;
+typedef void*        EGLSurface;
+typedef void*        EGLNativeDisplayType;
+typedef void (*__eglMustCastToProperFunctionPointerType)(void);
+
+#define EGL_DEFAULT_DISPLAY               ((EGLNativeDisplayType)0)
+#define EGL_NO_CONTEXT                    ((EGLContext)0)
+#define EGL_NO_DISPLAY                    ((EGLDisplay)0)
+#define EGL_NO_SURFACE                    ((EGLSurface)0)
+
+#define EGL_FALSE                         0
+#define EGL_TRUE                          1
+#define EGL_NONE                          0x3038
+#define EGL_EXTENSIONS                    0x3055
+#define EGL_VERSION                       0x3054
+#define EGL_VENDOR                        0x3053
+
+#define EGL_BLUE_SIZE                     0x3022
+#define EGL_GREEN_SIZE                    0x3023
+#define EGL_RED_SIZE                      0x3024
+#define EGL_SURFACE_TYPE                  0x3033
+#define EGL_RENDERABLE_TYPE               0x3040
+#define EGL_OPENGL_ES2_BIT                0x0004
+#define EGL_OPENGL_BIT                    0x0008
+#define EGL_OPENGL_ES3_BIT                0x0040
+
+#define EGL_OPENGL_ES_API                 0x30A0
+#define EGL_OPENGL_API                    0x30A2
+
+#define EGL_CONTEXT_MAJOR_VERSION         0x3098
+#define EGL_CONTEXT_MINOR_VERSION         0x30FB
+#define EGL_CONTEXT_OPENGL_PROFILE_MASK   0x30FD
+#define EGL_CONTEXT_OPENGL_DEBUG          0x31B0
+#define EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT          0x00000001
+#define EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT 0x00000002
+
+// EGL_MESA_platform_surfaceless lets us get a display without X11 or Wayland, which our render nodes don't have
+#define EGL_PLATFORM_SURFACELESS_MESA     0x31DD
+
+typedef __eglMustCastToProperFunctionPointerType (*PFNEGLGETPROCADDRESSPROC)(const char* procname);
+typedef EGLint      (*PFNEGLGETERRORPROC)(void);
+typedef EGLDisplay  (*PFNEGLGETDISPLAYPROC)(EGLNativeDisplayType display_id);
+typedef EGLDisplay  (*PFNEGLGETPLATFORMDISPLAYEXTPROC)(EGLenum platform, void* native_display, const EGLint* attrib_list);
+typedef EGLBoolean  (*PFNEGLINITIALIZEPROC)(EGLDisplay dpy, EGLint* major, EGLint* minor);
+typedef const char* (*PFNEGLQUERYSTRINGPROC)(EGLDisplay dpy, EGLint name);
+typedef EGLBoolean  (*PFNEGLCHOOSECONFIGPROC)(EGLDisplay dpy, const EGLint* attrib_list, EGLConfig* configs, EGLint config_size, EGLint* num_config);
+typedef EGLBoolean  (*PFNEGLBINDAPIPROC)(EGLenum api);
+typedef EGLContext  (*PFNEGLCREATECONTEXTPROC)(EGLDisplay dpy, EGLConfig config, EGLContext share_context, const EGLint* attrib_list);
+typedef EGLBoolean  (*PFNEGLDESTROYCONTEXTPROC)(EGLDisplay dpy, EGLContext ctx);
+typedef EGLBoolean  (*PFNEGLMAKECURRENTPROC)(EGLDisplay dpy, EGLSurface draw, EGLSurface read, EGLContext ctx);
+
+// Everything here is EGL 1.4 so any libEGL should export it. eglGetPlatformDisplayEXT is an extension and is looked up through eglGetProcAddress
+#define ENUM_EGL_PROCEDURES(EnumMacro) \
+        EnumMacro(PFNEGLGETPROCADDRESSPROC, eglGetProcAddress) \
+        EnumMacro(PFNEGLGETERRORPROC, eglGetError) \
+        EnumMacro(PFNEGLGETDISPLAYPROC, eglGetDisplay) \
+        EnumMacro(PFNEGLINITIALIZEPROC, eglInitialize) \
+        EnumMacro(PFNEGLQUERYSTRINGPROC, eglQueryString) \
+        EnumMacro(PFNEGLCHOOSECONFIGPROC, eglChooseConfig) \
+        EnumMacro(PFNEGLBINDAPIPROC, eglBindAPI) \
+        EnumMacro(PFNEGLCREATECONTEXTPROC, eglCreateContext) \
+        EnumMacro(PFNEGLDESTROYCONTEXTPROC, eglDestroyContext) \
+        EnumMacro(PFNEGLMAKECURRENTPROC, eglMakeCurrent) \
+
+#define DECLARE_EGL_PROCEDURES(Type,Func) extern Type Func;
+ENUM_EGL_PROCEDURES(DECLARE_EGL_PROCEDURES);
+
+extern void* EGLDLL; // nullptr if libEGL couldn't be loaded in which case only software rendered cores will run
@@ -0,0 +1,99 @@
+#include "LibretroAudioQueue.h"
+
+#include "LibretroContext.h" // For STATGROUP_UnrealLibretro
+#include "UnrealLibretro.h" // For Libretro debug log category
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Audio Underruns"), STAT_LibretroAudioUnderruns, STATGROUP_UnrealLibretro);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Audio Overruns"), STAT_LibretroAudioOverruns, STATGROUP_UnrealLibretro);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Audio Frames Buffered"), STAT_LibretroAudioFramesBuffered, STATGROUP_UnrealLibretro);
+
+// The target moves in steps of this much. Small enough not to add much latency at a time, big enough that a struggling core settles quickly
+static constexpr uint32 AdaptStepMilliseconds = 10;
+
+// How long the audio has to play without running dry before we try lowering the target again
+static constexpr uint32 AdaptShrinkAfterSeconds = 10;
+
+static uint32 MillisecondsToFrames(uint32 SampleRate, uint32 Milliseconds)
+{
+    return FMath::Max(1u, (uint32)((uint64)SampleRate * Milliseconds / 1000));
+}
+
+FLibretroAudioQueue::FLibretroAudioQueue(uint32 SampleRate, uint32 TargetMilliseconds, uint32 MaxTargetMilliseconds, uint32 MaxFramesPerCallback)
+    : SampleRate(SampleRate),
+      MinTargetFrames(MillisecondsToFrames(SampleRate, TargetMilliseconds)),
+      MaxTargetFrames(MillisecondsToFrames(SampleRate, FMath::Max(TargetMilliseconds, MaxTargetMilliseconds))),
+      AdaptStepFrames(MillisecondsToFrames(SampleRate, AdaptStepMilliseconds)),
+      MaxFramesPerCallback(MaxFramesPerCallback),
+      Ring(MillisecondsToFrames(SampleRate, FMath::Max(TargetMilliseconds, MaxTargetMilliseconds)) * FrameSize),
+      TargetFrames(MillisecondsToFrames(SampleRate, TargetMilliseconds))
+{
+}
+
+FLibretroAudioQueue::~FLibretroAudioQueue()
+{
+    DEC_DWORD_STAT_BY(STAT_LibretroAudioFramesBuffered, GetBufferedFrames());
+}
+
+size_t FLibretroAudioQueue::Enqueue(const int16_t* Frames, size_t NumFrames)
+{
+    const uint32 Buffered = GetBufferedFrames();
+    const uint32 Target   = TargetFrames.load(std::memory_order_relaxed);
+    const uint32 Room     = Target > Buffered ? Target - Buffered : 0;
+
+    const size_t FramesEnqueued = Ring.Write(Frames, (uint32)FMath::Min<size_t>(NumFrames, Room) * FrameSize) / FrameSize;
+    INC_DWORD_STAT_BY(STAT_LibretroAudioFramesBuffered, FramesEnqueued);
+
+    if (FramesEnqueued != NumFrames)
+    {
+        // A paused audio device would otherwise count an overrun on every single write
+        if (!bOverflowing)
+        {
+            Overruns.fetch_add(1, std::memory_order_relaxed);
+            INC_DWORD_STAT(STAT_LibretroAudioOverruns);
+        }
+
+        UE_LOG(Libretro, Verbose, TEXT("Audio overrun. Dropped %u frames"), (uint32)(NumFrames - FramesEnqueued));
+    }
+    bOverflowing = FramesEnqueued != NumFrames;
+
+    return FramesEnqueued;
+}
+
+int32 FLibretroAudioQueue::Dequeue(uint8* PCMData, int32 NumFramesRequested)
+{
+    const int32 FramesToGive   = MaxFramesPerCallback > 0 ? FMath::Min(MaxFramesPerCallback, NumFramesRequested) : NumFramesRequested;
+    const int32 FramesDequeued = Ring.Read(PCMData, FramesToGive * FrameSize) / FrameSize;
+    DEC_DWORD_STAT_BY(STAT_LibretroAudioFramesBuffered, FramesDequeued);
+
+    if (FramesDequeued != FramesToGive)
+    {
+        FMemory::Memzero(PCMData + FramesDequeued * FrameSize, (FramesToGive - FramesDequeued) * FrameSize);
+
+        if (!bStarved)
+        {
+            Underruns.fetch_add(1, std::memory_order_relaxed);
+            INC_DWORD_STAT(STAT_LibretroAudioUnderruns);
+            UE_LOG(Libretro, Verbose, TEXT("Audio underrun. Filled %d frames with silence"), FramesToGive - FramesDequeued);
+
+            // Only we write the target so there's no need for anything fancier than a relaxed store
+            const uint32 Target = TargetFrames.load(std::memory_order_relaxed);
+            TargetFrames.store(FMath::Min(Target + AdaptStepFrames, MaxTargetFrames), std::memory_order_relaxed);
+            FramesSinceUnderrun = 0;
+        }
+        bStarved = true;
+    }
+    else
+    {
+        bStarved = false;
+        FramesSinceUnderrun += FramesDequeued;
+
+        const uint32 Target = TargetFrames.load(std::memory_order_relaxed);
+        if (Target > MinTargetFrames && FramesSinceUnderrun >= (uint64)SampleRate * AdaptShrinkAfterSeconds)
+        {
+            TargetFrames.store(Target - FMath::Min(Target - MinTargetFrames, AdaptStepFrames), std::memory_order_relaxed);
+            FramesSinceUnderrun = 0;
+        }
+    }
+
+    return FramesToGive;
+}
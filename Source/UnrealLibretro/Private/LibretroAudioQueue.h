@@ -0,0 +1,73 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "LibretroAudioRingBuffer.h"
+
+// Standard Template Library https://docs.unrealengine.com/en-US/Programming/Development/CodingStandard/#useofstandardlibraries
+#include <atomic>
+
+/**
+ * The audio a core has produced that the audio device hasn't played yet
+ *
+ * The libretro thread enqueues up to a target amount of buffered audio and drops what doesn't fit (an overrun). The audio
+ * render thread dequeues and plays silence for whatever isn't there yet (an underrun). The target is how much latency we're
+ * willing to add. In adaptive mode it's raised a step every time the core's audio runs dry, and lowered a step back toward
+ * where it started each time it goes a while without running dry.
+ *
+ * Audio is moved around in stereo frames of two int16 samples.
+ */
+class FLibretroAudioQueue
+{
+public:
+    /**
+     * @param TargetMilliseconds     How much audio to buffer ahead of the audio device
+     * @param MaxTargetMilliseconds  If more than TargetMilliseconds the target adapts between the two
+     * @param MaxFramesPerCallback   Most frames handed to the audio device per callback. 0 means however many it asks for
+     */
+    FLibretroAudioQueue(uint32 SampleRate, uint32 TargetMilliseconds, uint32 MaxTargetMilliseconds, uint32 MaxFramesPerCallback);
+    ~FLibretroAudioQueue();
+
+    /**
+     * Producer: Buffers as many frames as fit under the target
+     *
+     * @return Frames buffered
+     */
+    size_t Enqueue(const int16_t* Frames, size_t NumFrames);
+
+    /**
+     * Consumer: Fills in audio for the audio device, padding with silence if we don't have enough
+     *
+     * @param NumFramesRequested Stereo frames, not interleaved samples. PCMData has to have room for this many frames
+     * @return Frames written to PCMData. Can be fewer than asked for if we're capping how much is handed out per callback
+     */
+    int32 Dequeue(uint8* PCMData, int32 NumFramesRequested);
+
+    uint32 GetSampleRate() const { return SampleRate; }
+    uint32 GetBufferedFrames() const { return Ring.Num() / FrameSize; }
+    uint32 GetTargetFrames() const { return TargetFrames.load(std::memory_order_relaxed); }
+    uint64 GetUnderrunCount() const { return Underruns.load(std::memory_order_relaxed); }
+    uint64 GetOverrunCount() const { return Overruns.load(std::memory_order_relaxed); }
+
+    static constexpr uint32 FrameSize = 2 * sizeof(int16_t);
+
+protected:
+    const uint32 SampleRate;
+    const uint32 MinTargetFrames;
+    const uint32 MaxTargetFrames;
+    const uint32 AdaptStepFrames;
+    const int32  MaxFramesPerCallback;
+
+    FLibretroAudioRingBuffer Ring; // Sized for MaxTargetFrames so the target can move without reallocating
+
+    std::atomic<uint32> TargetFrames;
+    std::atomic<uint64> Underruns{0}; // Times the audio device went from having audio to running dry
+    std::atomic<uint64> Overruns{0};  // Times the core produced more audio than we had room for
+
+    // Consumer only
+    bool   bStarved{true}; // Running dry counts as one underrun until we can fill a whole callback again. Starts true so waiting for the first frame doesn't count
+    uint64 FramesSinceUnderrun{0};
+
+    // Producer only
+    bool   bOverflowing{false};
+};
@@ -0,0 +1,48 @@
+#include "LibretroAudioResampler.h"
+
+void FLibretroAudioResampler::SetInputSampleRate(double InputSampleRate)
+{
+    check(InputSampleRate > 0.0);
+    NominalRatio = OutputSampleRate / InputSampleRate;
+}
+
+TArrayView<const int16_t> FLibretroAudioResampler::Resample(const int16_t* Frames, size_t NumFrames, uint32 BufferedFrames, uint32 TargetFrames)
+{
+    if (NumFrames == 0)
+    {
+        return {};
+    }
+
+    // Positive when the queue is under half full so we stretch the audio to fill it back up, negative when it's over half full
+    const double HalfTarget = FMath::Max(1.0, TargetFrames / 2.0);
+    const double Direction  = FMath::Clamp((HalfTarget - BufferedFrames) / HalfTarget, -1.0, 1.0);
+    const double Ratio      = NominalRatio * (1.0 + MaxRateDeviation * Direction);
+    const double Step       = 1.0 / Ratio; // In input frames
+
+    // Input frame -1 is Previous, so output frame t interpolates between input frames floor(t) - 1 and floor(t)
+    const int32 MaxOutputFrames = FMath::CeilToInt((NumFrames - Position) * Ratio) + 1;
+    if (Output.Num() < 2 * MaxOutputFrames)
+    {
+        Output.SetNumUninitialized(2 * MaxOutputFrames);
+    }
+
+    int32 OutputFrames = 0;
+    double t = Position;
+    for (; t < NumFrames; t += Step, OutputFrames++)
+    {
+        const int32   i     = (int32)t;
+        const double  Frac  = t - i;
+        const int16_t* A    = i == 0 ? Previous : Frames + 2 * (i - 1);
+        const int16_t* B    = Frames + 2 * i;
+
+        Output[2 * OutputFrames + 0] = (int16_t)FMath::RoundToInt(A[0] + (B[0] - A[0]) * Frac);
+        Output[2 * OutputFrames + 1] = (int16_t)FMath::RoundToInt(A[1] + (B[1] - A[1]) * Frac);
+    }
+    check(OutputFrames <= MaxOutputFrames);
+
+    Position    = t - NumFrames;
+    Previous[0] = Frames[2 * (NumFrames - 1) + 0];
+    Previous[1] = Frames[2 * (NumFrames - 1) + 1];
+
+    return TArrayView<const int16_t>(Output.GetData(), 2 * OutputFrames);
+}
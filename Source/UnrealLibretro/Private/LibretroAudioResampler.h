@@ -0,0 +1,41 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Converts a core's audio to the rate we play it at, nudging the ratio by up to MaxRateDeviation to keep the audio queue half full
+ *
+ * A core paces itself by the clock on the libretro thread while the audio device plays by its own, so even when the sample
+ * rates match on paper the queue slowly drifts empty or full and we eventually get dropouts. This is the dynamic rate control
+ * RetroArch does: the further the queue is from half its target, the more we stretch or squeeze the audio to push it back,
+ * which is small enough that the pitch change isn't audible. See https://github.com/libretro/docs/blob/master/archive/ratecontrol.pdf
+ *
+ * Resampling is linear interpolation on stereo int16 frames. Libretro thread only.
+ */
+class FLibretroAudioResampler
+{
+public:
+    /** What URawAudioSoundWave plays at. The audio mixer runs at this rate by default on every platform we ship on so it passes straight through */
+    static constexpr uint32 OutputSampleRate = 48000;
+
+    /** 0.5% is the most RetroArch recommends before the pitch change becomes noticeable */
+    static constexpr double MaxRateDeviation = 0.005;
+
+    void SetInputSampleRate(double InputSampleRate);
+
+    /**
+     * @param BufferedFrames How many frames are in the audio queue right now
+     * @param TargetFrames   The most the audio queue will hold. We aim for half of it
+     * @return Interleaved stereo frames at OutputSampleRate. Only valid until the next call
+     */
+    TArrayView<const int16_t> Resample(const int16_t* Frames, size_t NumFrames, uint32 BufferedFrames, uint32 TargetFrames);
+
+protected:
+    double NominalRatio{1.0}; // Output frames per input frame before rate control
+
+    // Where the next output frame falls between Previous and the first frame of the next batch. Carrying these over means batches join seamlessly
+    double Position{0.0};
+    int16_t Previous[2]{0, 0};
+
+    TArray<int16_t> Output;
+};
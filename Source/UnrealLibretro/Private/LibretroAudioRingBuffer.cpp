@@ -0,0 +1,160 @@
+#include "LibretroAudioRingBuffer.h"
+
+#if !UE_BUILD_SHIPPING
+#include "Async/Async.h"
+#include "Containers/CircularQueue.h"
+#include "HAL/IConsoleManager.h"
+#include "UnrealLibretro.h" // For Libretro debug log category
+#endif
+
+static uint32 RoundUpCapacity(uint32 MinimumCapacityBytes)
+{
+    return FMath::RoundUpToPowerOfTwo(FMath::Max(MinimumCapacityBytes, (uint32)PLATFORM_CACHE_LINE_SIZE));
+}
+
+FLibretroAudioRingBuffer::FLibretroAudioRingBuffer(uint32 MinimumCapacityBytes)
+    : Buffer((uint8*)FMemory::Malloc(RoundUpCapacity(MinimumCapacityBytes), PLATFORM_CACHE_LINE_SIZE)),
+      Mask(RoundUpCapacity(MinimumCapacityBytes) - 1)
+{
+}
+
+FLibretroAudioRingBuffer::~FLibretroAudioRingBuffer()
+{
+    FMemory::Free(Buffer);
+}
+
+uint32 FLibretroAudioRingBuffer::Write(const void* Data, uint32 Bytes)
+{
+    const uint32 Write = WriteIndex.load(std::memory_order_relaxed);
+
+    if (Capacity() - (Write - CachedReadIndex) < Bytes)
+    {
+        CachedReadIndex = ReadIndex.load(std::memory_order_acquire);
+    }
+
+    Bytes = FMath::Min(Bytes, Capacity() - (Write - CachedReadIndex));
+
+    const uint32 Offset = Write & Mask;
+    const uint32 BeforeWrap = FMath::Min(Bytes, Capacity() - Offset);
+    FMemory::Memcpy(Buffer + Offset, Data, BeforeWrap);
+    FMemory::Memcpy(Buffer, (const uint8*)Data + BeforeWrap, Bytes - BeforeWrap);
+
+    WriteIndex.store(Write + Bytes, std::memory_order_release);
+
+    return Bytes;
+}
+
+uint32 FLibretroAudioRingBuffer::Read(void* Data, uint32 Bytes)
+{
+    const uint32 Read = ReadIndex.load(std::memory_order_relaxed);
+
+    if (CachedWriteIndex - Read < Bytes)
+    {
+        CachedWriteIndex = WriteIndex.load(std::memory_order_acquire);
+    }
+
+    Bytes = FMath::Min(Bytes, CachedWriteIndex - Read);
+
+    const uint32 Offset = Read & Mask;
+    const uint32 BeforeWrap = FMath::Min(Bytes, Capacity() - Offset);
+    FMemory::Memcpy(Data, Buffer + Offset, BeforeWrap);
+    FMemory::Memcpy((uint8*)Data + BeforeWrap, Buffer, Bytes - BeforeWrap);
+
+    ReadIndex.store(Read + Bytes, std::memory_order_release);
+
+    return Bytes;
+}
+
+#if !UE_BUILD_SHIPPING
+// Pushes the same stream of stereo frames through TCircularQueue<int32> the way we used to and through FLibretroAudioRingBuffer.
+// The producer writes in batches the size of one video frame worth of audio like most cores do, and the consumer reads 64 frames at a time like URawAudioSoundWave.
+// Both sides run on their own thread so the cost of the indices bouncing between cores is included
+static FAutoConsoleCommand GLibretroAudioRingBufferBenchmark(
+    TEXT("Libretro.BenchmarkAudioRingBuffer"),
+    TEXT("Compares moving audio through TCircularQueue and FLibretroAudioRingBuffer. Optional argument is the number of seconds of 48kHz audio to move (default 600)"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        const uint32 Seconds       = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 600;
+        const uint32 TotalFrames   = Seconds * 48000;
+        constexpr uint32 ProducerBatch = 800; // 48kHz at 60fps
+        constexpr uint32 ConsumerBatch = 64;
+        const uint32 CapacityFrames = 2400; // 50ms which is what we allocate for a core
+
+        auto Time = [&](const TCHAR* Name, TFunction<void()> Producer, TFunction<bool()> Consumer)
+        {
+            const double Start = FPlatformTime::Seconds();
+            auto ProducerDone = Async(EAsyncExecution::Thread, MoveTemp(Producer));
+            const bool bIntact = Consumer();
+            ProducerDone.Wait();
+            const double Elapsed = FPlatformTime::Seconds() - Start;
+
+            UE_LOG(Libretro, Display, TEXT("%-26s %8.2f ms  %6.2f ns/frame  %s"), Name, Elapsed * 1000.0, Elapsed * 1e9 / TotalFrames, bIntact ? TEXT("") : TEXT("DATA CORRUPTED"));
+        };
+
+        // Frame i carries the value i so the consumer can tell if anything got lost or reordered
+        {
+            TCircularQueue<int32> Queue(CapacityFrames);
+            Time(TEXT("TCircularQueue<int32>"),
+                [&]()
+                {
+                    for (uint32 Frame = 0; Frame < TotalFrames; )
+                    {
+                        for (const uint32 End = FMath::Min(Frame + ProducerBatch, TotalFrames); Frame < End; )
+                        {
+                            if (Queue.Enqueue(Frame)) Frame++; else FPlatformProcess::Sleep(0);
+                        }
+                    }
+                },
+                [&]()
+                {
+                    bool bIntact = true;
+                    int32 Value;
+                    for (uint32 Frame = 0; Frame < TotalFrames; )
+                    {
+                        for (uint32 i = 0; i < ConsumerBatch && Frame < TotalFrames && Queue.Peek(Value); i++, Frame++)
+                        {
+                            bIntact &= (uint32)Value == Frame;
+                            Queue.Dequeue();
+                        }
+                    }
+                    return bIntact;
+                });
+        }
+
+        {
+            FLibretroAudioRingBuffer Ring(CapacityFrames * sizeof(uint32));
+            Time(TEXT("FLibretroAudioRingBuffer"),
+                [&]()
+                {
+                    uint32 Batch[ProducerBatch];
+                    for (uint32 Frame = 0; Frame < TotalFrames; )
+                    {
+                        const uint32 BatchFrames = FMath::Min(ProducerBatch, TotalFrames - Frame);
+                        for (uint32 i = 0; i < BatchFrames; i++) Batch[i] = Frame + i;
+
+                        for (uint32 Written = 0; Written < BatchFrames; )
+                        {
+                            const uint32 Frames = Ring.Write(Batch + Written, (BatchFrames - Written) * sizeof(uint32)) / sizeof(uint32);
+                            if (Frames) Written += Frames; else FPlatformProcess::Sleep(0);
+                        }
+                        Frame += BatchFrames;
+                    }
+                },
+                [&]()
+                {
+                    bool bIntact = true;
+                    uint32 Batch[ConsumerBatch];
+                    for (uint32 Frame = 0; Frame < TotalFrames; )
+                    {
+                        const uint32 Frames = Ring.Read(Batch, ConsumerBatch * sizeof(uint32)) / sizeof(uint32);
+                        for (uint32 i = 0; i < Frames; i++)
+                        {
+                            bIntact &= Batch[i] == Frame + i;
+                        }
+                        Frame += Frames;
+                    }
+                    return bIntact;
+                });
+        }
+    }));
+#endif
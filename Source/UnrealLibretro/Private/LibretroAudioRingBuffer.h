@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Standard Template Library https://docs.unrealengine.com/en-US/Programming/Development/CodingStandard/#useofstandardlibraries
+#include <atomic>
+
+/**
+ * Lock-free ring of bytes that moves audio from one producer thread (the libretro thread) to one consumer thread (the audio render thread)
+ *
+ * TCircularQueue costs an atomic round trip per element, and with one element per stereo frame that adds up fast at 48kHz.
+ * Here reads and writes are bulk memcpys that get split in two where they wrap. Each side keeps a cached copy of the other
+ * side's index and only goes back to the shared one when the cached value says there isn't enough room. So a whole
+ * batch costs at most one acquire load and exactly one release store.
+ *
+ * Transfers are partial when there isn't enough room or data. As long as every Write and Read is a multiple of the frame size
+ * the partial transfers will be too, since the capacity is a power of two.
+ */
+class FLibretroAudioRingBuffer
+{
+public:
+    /** @param MinimumCapacityBytes Rounded up to a power of two */
+    explicit FLibretroAudioRingBuffer(uint32 MinimumCapacityBytes);
+    ~FLibretroAudioRingBuffer();
+
+    FLibretroAudioRingBuffer(const FLibretroAudioRingBuffer&) = delete;
+    FLibretroAudioRingBuffer& operator=(const FLibretroAudioRingBuffer&) = delete;
+
+    /**
+     * Producer: Copies in as much of Data as fits and publishes it in one go
+     *
+     * @return Bytes written
+     */
+    uint32 Write(const void* Data, uint32 Bytes);
+
+    /**
+     * Consumer: Copies out up to Bytes of what's been published
+     *
+     * @return Bytes read
+     */
+    uint32 Read(void* Data, uint32 Bytes);
+
+    /** Bytes waiting to be read. Exact from the consumer, a lower bound from the producer */
+    uint32 Num() const { return WriteIndex.load(std::memory_order_acquire) - ReadIndex.load(std::memory_order_acquire); }
+
+    uint32 Capacity() const { return Mask + 1; }
+
+private:
+    // The indices only ever increase and are masked on access. Unsigned overflow keeps the difference between them correct
+    uint8* const Buffer;
+    const uint32 Mask;
+
+    // Each line is written by one side only. The cached copies of the other side's index ride along on the line of the side that uses them
+    alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> WriteIndex{0};
+                                      uint32              CachedReadIndex{0};  // Producer only
+    alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> ReadIndex{0};
+                                      uint32              CachedWriteIndex{0}; // Consumer only
+};
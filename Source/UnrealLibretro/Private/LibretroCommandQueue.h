@@ -0,0 +1,155 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Standard Template Library https://docs.unrealengine.com/en-US/Programming/Development/CodingStandard/#useofstandardlibraries
+#include <atomic>
+#include <new>
+
+/**
+ * Bounded lock-free queue of commands that any number of threads can enqueue into and one thread runs
+ *
+ * It's Dmitry Vyukov's bounded MPMC queue with the consumer side simplified since there's only one consumer. Every slot has a
+ * sequence number that says whose turn it is: a producer claims a slot by bumping the enqueue position when the slot's sequence
+ * matches it, constructs the command in place, then bumps the sequence to hand it to the consumer. The consumer runs it in place
+ * and bumps the sequence a lap ahead to hand the slot back to the producers.
+ *
+ * Commands are stored inline in the slots so enqueueing never allocates, which means whatever a command captures has to fit in
+ * InlineBytes. That's checked at compile time. When every slot is taken TryEnqueue fails rather than waiting, and it's counted.
+ */
+template<typename ArgType, uint32 Capacity, SIZE_T InlineBytes = 64>
+class TLibretroCommandQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+
+public:
+    TLibretroCommandQueue()
+    {
+        for (uint32 i = 0; i < Capacity; i++)
+        {
+            Slots[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~TLibretroCommandQueue()
+    {   // Nothing can be enqueueing anymore so whatever is left is just destroyed without running
+        while (FSlot* Slot = PeekReady())
+        {
+            Slot->Destroy(Slot->Storage);
+            Release(*Slot);
+        }
+    }
+
+    /**
+     * Any thread: Queues Command to be called with the argument the consumer passes to RunAll
+     *
+     * @param bAlwaysRun Run it even if RunAll is discarding commands
+     * @return false if the queue was full. Command isn't queued in that case
+     */
+    template<typename FunctorType>
+    bool TryEnqueue(FunctorType&& Command, bool bAlwaysRun = false)
+    {
+        using FCommand = typename TDecay<FunctorType>::Type;
+        static_assert(sizeof(FCommand) <= InlineBytes, "The command captures too much to be stored inline. Capture a pointer or TSharedPtr to the bulky parts instead");
+        static_assert(alignof(FCommand) <= StorageAlignment, "The command is overaligned for the slot storage");
+
+        FSlot* Slot;
+        uint64 Position = EnqueuePosition.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot = &Slots[Position & (Capacity - 1)];
+            const int64 Lag = (int64)(Slot->Sequence.load(std::memory_order_acquire) - Position);
+
+            if (Lag == 0)
+            {   // The slot is free for this position so we try to claim the position
+                if (EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (Lag < 0)
+            {   // The consumer hasn't gotten around to the command that was here a lap ago
+                Rejected.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {   // Another producer claimed this position first
+                Position = EnqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (Slot->Storage) FCommand(Forward<FunctorType>(Command));
+        Slot->Run     = [](void* Storage, ArgType Arg) { FCommand& Command = *(FCommand*)Storage; Command(Arg); Command.~FCommand(); };
+        Slot->Destroy = [](void* Storage) { ((FCommand*)Storage)->~FCommand(); };
+        Slot->bAlwaysRun = bAlwaysRun;
+        Slot->Sequence.store(Position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * Consumer: Runs the queued commands in the order they were enqueued
+     *
+     * Stops at the first slot that's claimed but not filled in yet, so a producer halfway through enqueueing only delays
+     * the commands behind it until the next call. Commands are allowed to enqueue more commands
+     *
+     * @param bDiscard Destroy commands without running them instead, except for those enqueued with bAlwaysRun
+     * @return How many commands were run
+     */
+    int32 RunAll(ArgType Arg, bool bDiscard = false)
+    {
+        int32 NumRun = 0;
+        while (FSlot* Slot = PeekReady())
+        {
+            if (bDiscard && !Slot->bAlwaysRun)
+            {
+                Slot->Destroy(Slot->Storage);
+            }
+            else
+            {
+                Slot->Run(Slot->Storage, Arg);
+                NumRun++;
+            }
+            Release(*Slot);
+        }
+
+        return NumRun;
+    }
+
+    /** Times TryEnqueue failed because the queue was full */
+    uint64 GetRejectedCount() const { return Rejected.load(std::memory_order_relaxed); }
+
+    static constexpr uint32 GetCapacity() { return Capacity; }
+
+private:
+    static constexpr SIZE_T StorageAlignment = 16;
+
+    struct FSlot
+    {
+        std::atomic<uint64> Sequence;
+        void (*Run)(void* Storage, ArgType Arg);
+        void (*Destroy)(void* Storage);
+        bool bAlwaysRun;
+        alignas(StorageAlignment) uint8 Storage[InlineBytes];
+    };
+
+    FSlot* PeekReady()
+    {
+        FSlot& Slot = Slots[DequeuePosition & (Capacity - 1)];
+        return Slot.Sequence.load(std::memory_order_acquire) == DequeuePosition + 1 ? &Slot : nullptr;
+    }
+
+    void Release(FSlot& Slot)
+    {
+        Slot.Sequence.store(DequeuePosition + Capacity, std::memory_order_release);
+        DequeuePosition++;
+    }
+
+    FSlot Slots[Capacity];
+
+    // Producers fight over the enqueue position while the dequeue position is only ever touched by the consumer so they get their own cache lines
+    alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> EnqueuePosition{0};
+    alignas(PLATFORM_CACHE_LINE_SIZE) uint64 DequeuePosition{0};
+
+    std::atomic<uint64> Rejected{0};
+};
@@ -1,8 +1,4 @@
 #include "LibretroContext.h"
-extern "C"
-{
-#include "gfx/scaler/pixconv.h"
-}
 
 #include "Misc/FileHelper.h"
 
@@ -10,10 +6,18 @@ extern "C"
 #include "UnrealLibretro.h" // For Libretro debug log category
 #include "LibretroSettings.h"
 #include "LibretroInputDefinitions.h"
-#include "LambdaRunnable.h"
+#include "LibretroScheduler.h"
+#include "LibretroLaunchQueue.h"
+#include "LibretroCoreLibrary.h"
+#include "LibretroPixelConversion.h"
 
 #include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/Event.h"
+#include "Misc/ScopeRWLock.h"
 #include "Misc/Paths.h"
+#include "Misc/App.h"
 #include "TextureResource.h"
 #include "RenderingThread.h"
 #include "Runtime/Launch/Resources/Version.h"
@@ -25,7 +29,10 @@ extern "C"
 #if PLATFORM_WINDOWS
 #include "Windows/AllowWindowsPlatformTypes.h"
 #include <d3d12.h>
+#include <intrin.h>
 #include "Windows/HideWindowsPlatformTypes.h"
+#else
+#include <dlfcn.h>
 #endif
 
 #if PLATFORM_ANDROID
@@ -33,6 +40,10 @@ extern "C"
 
 #include <android/native_window.h> // requires ndk r5 or newer
 #include <EGL/egl.h> // requires ndk r5 or newer
+#elif PLATFORM_LINUX
+#define GL_GET_PROC_ADDRESS eglGetProcAddress
+
+#include "GL/egl_definitions.h"
 #endif
 
 // Android errors trying to use debug context for some reason even with EGL 1.5
@@ -40,42 +51,91 @@ extern "C"
 #define DEBUG_OPENGL_CALLBACK
 #endif
 
-// MY EYEEEEESSS.... Even though this looks heavily obfuscated what this actually accomplishes is relatively simple. It allows us to run multiple libretro cores at once. 
-// We have to do it this way because when libretro calls a callback we implemented there really isn't any suitable way to tell which core the call came from.
-// So we just statically generate a bunch of callback functions with macros and write their function pointers into an array of libretro_callbacks_t's and issue them at runtime.
-// These generated callbacks call std::functions which can capture arguments. So we capture this and now it calls our callbacks on a per instance basis.
-#define REP10(P, M)  M(P##0) M(P##1) M(P##2) M(P##3) M(P##4) M(P##5) M(P##6) M(P##7) M(P##8) M(P##9)
-#define REP100(M) REP10(,M) REP10(1,M) REP10(2,M) REP10(3,M) REP10(4,M) REP10(5,M) REP10(6,M) REP10(7,M) REP10(8,M) REP10(9,M)
-
-extern struct libretro_callbacks_t {
-    retro_audio_sample_batch_t                                                c_audio_write;
-    retro_video_refresh_t                                                     c_video_refresh;
-    retro_audio_sample_t                                                      c_audio_sample;
-    retro_environment_t                                                       c_environment;
-    retro_input_poll_t                                                        c_input_poll;
-    retro_input_state_t                                                       c_input_state;
-    retro_hw_get_current_framebuffer_t                                        c_get_current_framebuffer;
-    TUniqueFunction<TRemovePointer<retro_audio_sample_batch_t        >::Type>   audio_write; // Changed these to TUniqueFunction because std::function throws exceptions even with -O3 and -fno-exceptions surprisingly https://godbolt.org/z/oqP3vT
-    TUniqueFunction<TRemovePointer<retro_video_refresh_t             >::Type>   video_refresh;
-    TUniqueFunction<TRemovePointer<retro_audio_sample_t              >::Type>   audio_sample;
-    TUniqueFunction<TRemovePointer<retro_environment_t               >::Type>   environment;
-    TUniqueFunction<TRemovePointer<retro_input_poll_t                >::Type>   input_poll;
-    TUniqueFunction<TRemovePointer<retro_input_state_t               >::Type>   input_state;
-    TUniqueFunction<TRemovePointer<retro_hw_get_current_framebuffer_t>::Type>   get_current_framebuffer;
-} libretro_callbacks_table[];
-
-#define FUNC_WRAP_INIT(M) {      func_wrap_audio_write##M, func_wrap_video_refresh##M, func_wrap_audio_sample##M, func_wrap_environment##M, func_wrap_input_poll##M, func_wrap_input_state##M, func_wrap_get_current_framebuffer##M },
-#define FUNC_WRAP_DEF(M) size_t  func_wrap_audio_write##M(const int16_t *data, size_t frames) { return libretro_callbacks_table[M].audio_write(data, frames); } \
-                         void    func_wrap_video_refresh##M(const void *data, unsigned width, unsigned height, size_t pitch) { return libretro_callbacks_table[M].video_refresh(data, width, height, pitch); } \
-                         void    func_wrap_audio_sample##M(int16_t left, int16_t right) { return libretro_callbacks_table[M].audio_sample(left, right); } \
-                         bool    func_wrap_environment##M(unsigned cmd, void *data) { return libretro_callbacks_table[M].environment(cmd, data); } \
-                         void    func_wrap_input_poll##M() { return libretro_callbacks_table[M].input_poll(); } \
-                         int16_t func_wrap_input_state##M(unsigned port, unsigned device, unsigned index, unsigned id) { return libretro_callbacks_table[M].input_state(port, device, index, id); } \
-                         uintptr_t func_wrap_get_current_framebuffer##M() { return libretro_callbacks_table[M].get_current_framebuffer(); }
-
-
-REP100(FUNC_WRAP_DEF)
-libretro_callbacks_t libretro_callbacks_table[] = { REP100(FUNC_WRAP_INIT) };
+// When libretro calls a callback we implemented there really isn't any suitable way to tell which core the call came from. However a core only ever
+// calls us back from inside whichever of its functions we're calling at the time, and we only ever call into a core from the worker stepping it.
+// So each worker keeps track of which core it's stepping and the callbacks we hand every core just forward to that one. Some cores do call us
+// back from threads of their own though (input and audio from an emulation thread, get_current_framebuffer from a GPU thread). Those find no
+// current context so we fall back to looking up whichever core's module the call came from, which is slower but only they pay for it
+static thread_local FLibretroContext* current_context = nullptr;
+
+static FRWLock core_modules_lock;
+static TMap<const void*, FLibretroContext*> core_modules; // Base address of each loaded core's module to its context
+static std::atomic<uint32> core_modules_generation{0};   // Bumped whenever core_modules changes so threads know to drop what they cached from it
+
+#if PLATFORM_WINDOWS
+#define CALLER_ADDRESS() _ReturnAddress()
+#else
+#define CALLER_ADDRESS() __builtin_return_address(0)
+#endif
+
+static const void* module_base(const void* address) {
+#if PLATFORM_WINDOWS
+    HMODULE module = nullptr;
+    GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCWSTR)address, &module);
+    return module;
+#else
+    Dl_info info;
+    return dladdr(address, &info) ? info.dli_fbase : nullptr;
+#endif
+}
+
+static FLibretroContext* resolve_context(const void* caller) {
+    if (LIKELY(current_context)) {
+        return current_context;
+    }
+
+    // A core's thread calls us back from the same handful of places over and over, and every call site is in exactly one module, so we remember
+    // what each call site resolved to. That way only the first call from each site pays for the module lookup and the lock
+    struct cached_caller {
+        const void* caller;
+        FLibretroContext* context;
+        uint32 generation;
+    };
+    static thread_local cached_caller cache[4] = {};
+    static thread_local unsigned cache_next = 0;
+
+    const uint32 generation = core_modules_generation.load(std::memory_order_acquire);
+    for (const cached_caller& cached : cache) {
+        if (cached.caller == caller && cached.generation == generation) {
+            return cached.context;
+        }
+    }
+
+    FLibretroContext* context = nullptr;
+    if (const void* base = module_base(caller)) {
+        FRWScopeLock scoped_lock(core_modules_lock, SLT_ReadOnly);
+        if (FLibretroContext** found = core_modules.Find(base)) {
+            context = *found;
+        }
+    }
+
+    cache[cache_next++ % (sizeof(cache) / sizeof(cache[0]))] = { caller, context, generation };
+
+    if (!context) {
+        static std::atomic<bool> logged{false};
+        if (!logged.exchange(true)) {
+            UE_LOG(Libretro, Error, TEXT("A core called us back from a thread we couldn't trace back to any core. The call was ignored and further ones will be without logging"));
+        }
+    }
+
+    return context;
+}
+
+// Makes Context the one callbacks on this thread go to for as long as it's in scope
+struct FScopedCurrentContext {
+    FLibretroContext* Previous;
+
+    FScopedCurrentContext(FLibretroContext* Context) : Previous(current_context) { current_context = Context; }
+    ~FScopedCurrentContext() { current_context = Previous; }
+};
+
+bool      FLibretroContext::dispatch_environment(unsigned cmd, void *data) { auto l = resolve_context(CALLER_ADDRESS()); return l ? l->core_environment(cmd, data) : false; }
+void      FLibretroContext::dispatch_video_refresh(const void *data, unsigned width, unsigned height, size_t pitch) { if (auto l = resolve_context(CALLER_ADDRESS())) l->core_video_refresh(data, width, height, pitch); }
+void      FLibretroContext::dispatch_input_poll() { if (auto l = resolve_context(CALLER_ADDRESS())) l->core_input_poll(); }
+int16_t   FLibretroContext::dispatch_input_state(unsigned port, unsigned device, unsigned index, unsigned id) { auto l = resolve_context(CALLER_ADDRESS()); return l ? l->core_input_state(port, device, index, id) : 0; }
+void      FLibretroContext::dispatch_audio_sample(int16_t left, int16_t right) { if (auto l = resolve_context(CALLER_ADDRESS())) l->core_audio_sample(left, right); }
+size_t    FLibretroContext::dispatch_audio_write(const int16_t *data, size_t frames) { auto l = resolve_context(CALLER_ADDRESS()); if (!l) return 0; l->core.audio.frames_batched += frames; return l->core_audio_write(data, frames); }
+uintptr_t FLibretroContext::dispatch_get_current_framebuffer() { auto l = resolve_context(CALLER_ADDRESS()); return l ? l->core.gl.framebuffer : 0; }
 
 #define load_sym(V, S) do {\
     if (0 == ((*(void**)&V) = FPlatformProcess::GetDllExport(libretro_api.handle, TEXT(#S)))) \
@@ -131,6 +191,9 @@ static bool GLLogCall(const char* function, const char* file, int line)
     return true;
 }
 
+// Several cores' contexts can end up pinned to the same worker so we keep track of whose is current and switch as we go
+static thread_local const FLibretroContext* current_gl_context = nullptr;
+
  void FLibretroContext::create_window() {
 #if PLATFORM_ANDROID
     // Get an OpenGL context via EGL
@@ -171,6 +234,102 @@ static bool GLLogCall(const char* function, const char* file, int line)
     }
 
     //static_assert(EGL_KHR_surfaceless_context, TEXT("This check may break as a false positive. ndk r21 defines this as a macro might need to be queried at runtime on other platforms"));
+    if (!eglMakeCurrent(core.gl.egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, core.gl.egl_context)) {
+        UE_LOG(Libretro, Fatal, TEXT("eglMakeCurrent() returned error %d"), eglGetError());
+    }
+#elif PLATFORM_LINUX
+    // Our Linux machines are render and test nodes without a display server and often without a GPU, so we never touch X11 or Wayland.
+    // Mesa's surfaceless platform gives us a display backed by whatever render node it finds, or llvmpipe if there isn't one
+    if (!EGLDLL) {
+        UE_LOG(Libretro, Fatal, TEXT("Hardware rendered cores need libEGL.so.1. Install Mesa (libegl1 and libgl1-mesa-dri) which works even without a GPU"));
+    }
+
+    auto has_extension = [](const char* extensions, const char* name) {
+        // Extensions are space separated so we have to match whole words, EGL_KHR_surfaceless_context is a prefix of other names
+        const size_t length = FCStringAnsi::Strlen(name);
+        for (const char* found = extensions; extensions && (found = FCStringAnsi::Strstr(found, name)); found += length) {
+            if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0')) {
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    // Client extensions are queried without a display. Drivers that predate EGL 1.5 return NULL here
+    const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    core.gl.egl_display = EGL_NO_DISPLAY;
+    if (eglGetPlatformDisplayEXT && has_extension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+        core.gl.egl_display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+
+    if (core.gl.egl_display == EGL_NO_DISPLAY) {
+        // Proprietary drivers don't have the Mesa platform but will usually hand back a headless display here
+        UE_LOG(Libretro, Log, TEXT("EGL: EGL_MESA_platform_surfaceless isn't available falling back to the default display"));
+        if ((core.gl.egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY)) == EGL_NO_DISPLAY) {
+            UE_LOG(Libretro, Fatal, TEXT("eglGetDisplay() returned error %d"), eglGetError());
+        }
+    }
+
+    // Displays are shared by the whole process so this is a no-op for every core after the first. That's also why we never call eglTerminate
+    EGLint egl_major, egl_minor;
+    if (!eglInitialize(core.gl.egl_display, &egl_major, &egl_minor)) {
+        UE_LOG(Libretro, Fatal, TEXT("eglInitialize() returned error %d"), eglGetError());
+    }
+
+    UE_LOG(Libretro, Log, TEXT("EGL: Initialized version %d.%d from '%s'"), egl_major, egl_minor, ANSI_TO_TCHAR(eglQueryString(core.gl.egl_display, EGL_VENDOR)));
+
+    // We render into our own framebuffer object so we never need a surface, but the context has to be allowed to be current without one
+    if (!has_extension(eglQueryString(core.gl.egl_display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+        UE_LOG(Libretro, Fatal, TEXT("EGL: The display doesn't support EGL_KHR_surfaceless_context"));
+    }
+
+    const bool is_gles = core.hw.context_type == RETRO_HW_CONTEXT_OPENGLES2
+                      || core.hw.context_type == RETRO_HW_CONTEXT_OPENGLES3
+                      || core.hw.context_type == RETRO_HW_CONTEXT_OPENGLES_VERSION;
+
+    const EGLint attribs[] = {
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_SURFACE_TYPE, 0, // Surfaceless displays may not have any window or pbuffer capable configs
+        EGL_RENDERABLE_TYPE, is_gles ? (core.hw.version_major >= 3 ? EGL_OPENGL_ES3_BIT : EGL_OPENGL_ES2_BIT) : EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint numConfigs;
+    if (!eglChooseConfig(core.gl.egl_display, attribs, &config, 1, &numConfigs) || numConfigs == 0) {
+        UE_LOG(Libretro, Fatal, TEXT("eglChooseConfig() returned error %d"), eglGetError());
+    }
+
+    // The bound API is thread local and this is the libretro thread so it won't interfere with anything else
+    if (!eglBindAPI(is_gles ? EGL_OPENGL_ES_API : EGL_OPENGL_API)) {
+        UE_LOG(Libretro, Fatal, TEXT("eglBindAPI() returned error %d"), eglGetError());
+    }
+
+    // RETRO_HW_CONTEXT_OPENGL is a compatibility context and cores often leave the version at 0 for it, which just means give me whatever
+    TArray<EGLint, TInlineAllocator<16>> attrib_list;
+    if (core.hw.version_major) {
+        attrib_list.Append({ EGL_CONTEXT_MAJOR_VERSION, (EGLint) core.hw.version_major,
+                             EGL_CONTEXT_MINOR_VERSION, (EGLint) core.hw.version_minor });
+    }
+    if (!is_gles) {
+        attrib_list.Append({ EGL_CONTEXT_OPENGL_PROFILE_MASK, core.hw.context_type == RETRO_HW_CONTEXT_OPENGL_CORE ? EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT
+                                                                                                                  : EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT });
+    }
+#if defined(DEBUG_OPENGL_CALLBACK)
+    attrib_list.Append({ EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE });
+#endif
+    attrib_list.Add(EGL_NONE);
+
+    UE_LOG(Libretro, Log, TEXT("EGL: Trying to load OpenGL%s version %d.%d"), is_gles ? TEXT(" ES") : TEXT(""), core.hw.version_major, core.hw.version_minor);
+    if (!(core.gl.egl_context = eglCreateContext(core.gl.egl_display, config, EGL_NO_CONTEXT, attrib_list.GetData()))) {
+        UE_LOG(Libretro, Fatal, TEXT("eglCreateContext() returned error %d"), eglGetError());
+    }
+
     if (!eglMakeCurrent(core.gl.egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, core.gl.egl_context)) {
         UE_LOG(Libretro, Fatal, TEXT("eglMakeCurrent() returned error %d"), eglGetError());
     }
@@ -266,6 +425,49 @@ static bool GLLogCall(const char* function, const char* file, int line)
 
     UE_LOG(Libretro, Log, TEXT("GL_SHADING_LANGUAGE_VERSION: %s\n"), ANSI_TO_TCHAR((char*)glGetString(GL_SHADING_LANGUAGE_VERSION)));
     UE_LOG(Libretro, Log, TEXT("GL_VERSION: %s\n"), ANSI_TO_TCHAR((char*)glGetString(GL_VERSION)));
+
+    current_gl_context = this;
+}
+
+void FLibretroContext::make_gl_context_current() {
+    if (current_gl_context == this) {
+        return;
+    }
+
+#if PLATFORM_ANDROID || PLATFORM_LINUX
+    if (!eglMakeCurrent(core.gl.egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, core.gl.egl_context)) {
+        UE_LOG(Libretro, Fatal, TEXT("eglMakeCurrent() returned error %d"), eglGetError());
+    }
+#elif PLATFORM_WINDOWS
+    if (!wglMakeCurrent(core.gl.hdc, core.gl.context)) {
+        UE_LOG(Libretro, Fatal, TEXT("Failed to activate OpenGL context"));
+    }
+#endif
+
+    current_gl_context = this;
+}
+
+static TLibretroMailbox<FLibretroFrame>* allocate_frame_mailbox(unsigned max_width, unsigned max_height) {
+    auto mailbox = new TLibretroMailbox<FLibretroFrame>();
+    for (int32 i = 0; i < mailbox->NumSlots; i++) {
+        FLibretroFrame& Frame = mailbox->GetSlot(i);
+        Frame.Pitch  = 4 * max_width;
+        Frame.Buffer = FMemory::Malloc(Frame.Pitch * max_height, PLATFORM_CACHE_LINE_SIZE);
+    }
+
+    return mailbox;
+}
+
+static void free_frame_mailbox(TLibretroMailbox<FLibretroFrame>* mailbox) {
+    if (!mailbox) {
+        return;
+    }
+
+    for (int32 i = 0; i < mailbox->NumSlots; i++) {
+        FMemory::Free(mailbox->GetSlot(i).Buffer);
+    }
+
+    delete mailbox;
 }
 
  void FLibretroContext::video_configure(const struct retro_game_geometry *geom) {
@@ -275,93 +477,105 @@ static bool GLLogCall(const char* function, const char* file, int line)
     }
 
     // Unreal Resource init
-    void *SharedHandle = nullptr;
+    // Under -nullrhi or on a dedicated server nothing will ever look at the frames so we don't convert or upload them at all
+    if (FApp::CanEverRender()) {
+        Unreal.FrameMailbox  = allocate_frame_mailbox(geom->max_width, geom->max_height);
+        Unreal.FrameUploadId = FLibretroFrameUploader::Get().Register(&Unreal.FrameSource, Unreal.FrameMailbox);
+    }
+
+    // Lots of cores have a max geometry several times their base geometry so we size the render target for what's actually presented and grow it as needed.
+    // If we're sharing the render target's memory with OpenGL we can't do that since OpenGL has to be able to render at the max geometry
+    Unreal.TextureWidth  = gl_win32_interop_supported_by_driver ? geom->max_width  : FMath::Max(1u, geom->base_width);
+    Unreal.TextureHeight = gl_win32_interop_supported_by_driver ? geom->max_height : FMath::Max(1u, geom->base_height);
+
+    // None of this waits on the game thread. The game thread sets up the render target and sound wave whenever it gets to it and
+    // hands the render target's texture to the uploader which just skips us until then. The tasks only capture copies since this
+    // context could be gone by the time they run
+    Unreal.AudioQueue = MakeShared<FLibretroAudioQueue, ESPMode::ThreadSafe>(FLibretroAudioResampler::OutputSampleRate,
+                                                                             Unreal.AudioBufferMilliseconds,
+                                                                             Unreal.AudioBufferMaxMilliseconds,
+                                                                             Unreal.MaxAudioFramesPerCallback);
+
+    // Sharing the render target's memory with OpenGL is the one thing we can't do without, so in that case we wait on the render thread for its native handle
+    struct FSharedTexture
+    {
+        void*    SharedHandle{nullptr};
+        uint64_t SizeInBytes{0};
+        uint64_t MipLevels{0};
+        GLenum   HandleType{0};
+        FEvent*  Ready{nullptr};
+    };
+    auto SharedTexture = MakeShared<FSharedTexture, ESPMode::ThreadSafe>();
+    if (gl_win32_interop_supported_by_driver) {
+        SharedTexture->Ready = FPlatformProcess::GetSynchEventFromPool(true);
+    }
 
-    uint64_t SizeInBytes, MipLevels;
-    GLenum handleType;
-    FTaskGraphInterface::Get().WaitUntilTaskCompletes(
-        FFunctionGraphTask::CreateAndDispatchWhenReady([&]
+    FFunctionGraphTask::CreateAndDispatchWhenReady(
+        [RenderTarget = UnrealRenderTarget, SoundBuffer = UnrealSoundBuffer, AudioQueue = Unreal.AudioQueue, SharedTexture, bRenderTargetSized = bRenderTargetSized,
+         Width = Unreal.TextureWidth, Height = Unreal.TextureHeight, PixelFormat = UnrealPixelFormat, FrameUploadId = Unreal.FrameUploadId]()
+        {
+            // Video init
+            if (RenderTarget.IsValid())
             {
-                const unsigned CapacityMilliseconds = 50;
-                const unsigned CapacityFrames = CapacityMilliseconds * (core.av.timing.sample_rate / 1000.0);
-                Unreal.AudioQueue = MakeShared<TCircularQueue<int32>, ESPMode::ThreadSafe>(CapacityFrames); // @todo move to audio init when the hack below is removed
-
-                // Make sure the game objects haven't been GCed
-                if (!UnrealSoundBuffer.IsValid() || !UnrealRenderTarget.IsValid())
-                {   // @hack until we acquire our own resources and don't rely on getting them by proxy through a UObject
-                    ENQUEUE_RENDER_COMMAND(LibretroInitDummyRHIFramebuffer)
-                        ([this](FRHICommandListImmediate& RHICmdList)
-                            {
-#if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 2
-                                FRHITextureCreateDesc TextureDesc;
-                                TextureDesc.Extent = FIntPoint(core.av.geometry.max_width, core.av.geometry.max_height);
-                                TextureDesc.Format = UnrealPixelFormat;
-                                TextureDesc.NumMips = 1;
-                                TextureDesc.NumSamples = 1;
-                                TextureDesc.Flags = ETextureCreateFlags::CPUWritable | ETextureCreateFlags::Dynamic;
-                                TextureDesc.Dimension = ETextureDimension::Texture2D;
-
-                                TextureDesc.DebugName = TEXT("Dummy Texture for now");
-
-                                this->Unreal.TextureRHI = RHICreateTexture(TextureDesc);
-#else
-                                FRHIResourceCreateInfo Info{ TEXT("Dummy Texture for now") };
-
-                                this->Unreal.TextureRHI =
-                                    RHICreateTexture2D(core.av.geometry.max_width,
-                                        core.av.geometry.max_height,
-                                        UnrealPixelFormat,
-                                        1,
-                                        1,
-                                        TexCreate_CPUWritable | TexCreate_Dynamic,
-                                        Info);
-#endif
-                            });
-                }
-                else
+                RenderTarget->bGPUSharedFlag = true; // Allows us to share this rendertarget with other applications and APIs in this case OpenGL
+
+                // If a tick got to the core's video state before we ran the render target already has the newest size, which might be bigger than ours
+                if (!*bRenderTargetSized)
                 {
-                    // Video Init
-                    UnrealRenderTarget->bGPUSharedFlag = true; // Allows us to share this rendertarget with other applications and APIs in this case OpenGL
-                    UnrealRenderTarget->InitCustomFormat(core.av.geometry.max_width,
-                                                         core.av.geometry.max_height,
-                                                         UnrealPixelFormat,
-                                                         false);
-                    ENQUEUE_RENDER_COMMAND(LibretroInitRHIFramebuffer)
-                        ([&](FRHICommandListImmediate& RHICmdList)
-                            {
-                                const auto Resource = static_cast<FTextureRenderTarget2DResource*>(UnrealRenderTarget->GetRenderTargetResource());
-                                this->Unreal.TextureRHI = Resource->GetTextureRHI();
+                    RenderTarget->InitCustomFormat(Width, Height, PixelFormat, false);
+                    *bRenderTargetSized = true;
+                }
 
-                                if (gl_win32_interop_supported_by_driver)
-                                {
+                ENQUEUE_RENDER_COMMAND(LibretroInitRHIFramebuffer)(
+                    [Resource = static_cast<FTextureRenderTarget2DResource*>(RenderTarget->GameThread_GetRenderTargetResource()), FrameUploadId, SharedTexture](FRHICommandListImmediate& RHICmdList)
+                    {
+                        FLibretroFrameUploader::Get().SetTexture(FrameUploadId, Resource->GetTextureRHI());
+
+                        if (!SharedTexture->Ready)
+                        {
+                            return;
+                        }
 #if PLATFORM_WINDOWS
-                                    if ((FString)GDynamicRHI->GetName() == TEXT("D3D12"))
-                                    {
-                                        auto UE4D3DDevice = static_cast<ID3D12Device*>(GDynamicRHI->RHIGetNativeDevice());
-                                        static FThreadSafeCounter NamingIdx;
-                                        ID3D12Resource* ResolvedTexture = (ID3D12Resource*)this->Unreal.TextureRHI->GetTexture2D()->GetNativeResource();
-                                        D3D12_RESOURCE_DESC TextureAttributes = ResolvedTexture->GetDesc();
-                                        D3D12_RESOURCE_ALLOCATION_INFO TextureMemoryUsage = UE4D3DDevice->GetResourceAllocationInfo(0b0, 1, &TextureAttributes);
-                                        verify(!FAILED(UE4D3DDevice->CreateSharedHandle(ResolvedTexture, NULL, GENERIC_ALL, *FString::Printf(TEXT("OpenGLSharedFramebuffer_UnrealLibretro_%u"), NamingIdx.Increment()), &SharedHandle)));
-                                        check(SharedHandle);
-
-                                        MipLevels = TextureAttributes.MipLevels;
-                                        SizeInBytes = TextureMemoryUsage.SizeInBytes;
-                                        handleType = GL_HANDLE_TYPE_D3D12_RESOURCE_EXT;
-                                    }
+                        if ((FString)GDynamicRHI->GetName() == TEXT("D3D12"))
+                        {
+                            auto UE4D3DDevice = static_cast<ID3D12Device*>(GDynamicRHI->RHIGetNativeDevice());
+                            static FThreadSafeCounter NamingIdx;
+                            ID3D12Resource* ResolvedTexture = (ID3D12Resource*)Resource->GetTextureRHI()->GetTexture2D()->GetNativeResource();
+                            D3D12_RESOURCE_DESC TextureAttributes = ResolvedTexture->GetDesc();
+                            D3D12_RESOURCE_ALLOCATION_INFO TextureMemoryUsage = UE4D3DDevice->GetResourceAllocationInfo(0b0, 1, &TextureAttributes);
+                            verify(!FAILED(UE4D3DDevice->CreateSharedHandle(ResolvedTexture, NULL, GENERIC_ALL, *FString::Printf(TEXT("OpenGLSharedFramebuffer_UnrealLibretro_%u"), NamingIdx.Increment()), &SharedTexture->SharedHandle)));
+                            check(SharedTexture->SharedHandle);
+
+                            SharedTexture->MipLevels   = TextureAttributes.MipLevels;
+                            SharedTexture->SizeInBytes = TextureMemoryUsage.SizeInBytes;
+                            SharedTexture->HandleType  = GL_HANDLE_TYPE_D3D12_RESOURCE_EXT;
+                        }
 #endif
-                                }
-                            });
-                    FlushRenderingCommands();
+                        SharedTexture->Ready->Trigger();
+                    });
+            }
+            else if (SharedTexture->Ready)
+            {   // The render target was GCed so OpenGL just gets a texture of its own
+                SharedTexture->Ready->Trigger();
+            }
 
-                    // Audio init
-                    UnrealSoundBuffer->SetSampleRate(core.av.timing.sample_rate);
-                    UnrealSoundBuffer->NumChannels = 2;
-                    UnrealSoundBuffer->AudioQueue = Unreal.AudioQueue;
+            // Audio init
+            if (SoundBuffer.IsValid())
+            {
+                SoundBuffer->SetSampleRate(FLibretroAudioResampler::OutputSampleRate);
+                SoundBuffer->NumChannels = 2;
+                SoundBuffer->AudioQueue = AudioQueue;
+            }
+        }, TStatId(), nullptr, ENamedThreads::GameThread);
+
+    if (SharedTexture->Ready) {
+        SharedTexture->Ready->Wait();
+        FPlatformProcess::ReturnSynchEventToPool(SharedTexture->Ready);
     }
-        
-            }, TStatId(), nullptr, ENamedThreads::GameThread)
-    ); // mfence
+    void*    SharedHandle = SharedTexture->SharedHandle;
+    uint64_t SizeInBytes  = SharedTexture->SizeInBytes;
+    uint64_t MipLevels    = SharedTexture->MipLevels;
+    GLenum   handleType   = SharedTexture->HandleType;
 
     // Libretro Core resource init
     if (core.using_opengl) { 
@@ -402,18 +616,20 @@ static bool GLLogCall(const char* function, const char* file, int line)
 
         if (   core.hw.depth  
             && core.hw.stencil) {
+            core.gl.renderbuffer_format = GL_DEPTH24_STENCIL8;
             glGenRenderbuffers(1, &core.gl.renderbuffer);
             glBindRenderbuffer(GL_RENDERBUFFER, core.gl.renderbuffer);
-            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, geom->max_width, 
-                                                                        geom->max_height);
+            glRenderbufferStorage(GL_RENDERBUFFER, core.gl.renderbuffer_format, geom->max_width, 
+                                                                                geom->max_height);
 
             glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, core.gl.renderbuffer);
         }
         else if (core.hw.depth) {
+            core.gl.renderbuffer_format = GL_DEPTH_COMPONENT24;
             glGenRenderbuffers(1, &core.gl.renderbuffer);
             glBindRenderbuffer(GL_RENDERBUFFER, core.gl.renderbuffer);
-            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, geom->max_width, 
-                                                                         geom->max_height);
+            glRenderbufferStorage(GL_RENDERBUFFER, core.gl.renderbuffer_format, geom->max_width, 
+                                                                                geom->max_height);
 
             glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, core.gl.renderbuffer);
         }  
@@ -428,119 +644,303 @@ static bool GLLogCall(const char* function, const char* file, int line)
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
         {
-            glGenBuffers(2, core.gl.pixel_buffer_objects);
-            for (int i = 0; i < sizeof(core.gl.pixel_buffer_objects) / sizeof(GLuint); i++)
+            for (unsigned i = 0; i < core.gl.readback_depth; i++)
             {
-                glBindBuffer(GL_PIXEL_PACK_BUFFER, core.gl.pixel_buffer_objects[i]);
+                glGenBuffers(1, &core.gl.readback[i].pixel_buffer_object);
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, core.gl.readback[i].pixel_buffer_object);
                 glBufferData(GL_PIXEL_PACK_BUFFER, 4 * geom->max_width * geom->max_height, 0, GL_DYNAMIC_READ);
             }
             glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
         }
     } else {
-        for (auto i : { 0, 1 }) {
-            core.software.bgra_buffers[i] = FMemory::Malloc(4 * core.av.geometry.max_width
-                                                              * core.av.geometry.max_height, PLATFORM_CACHE_LINE_SIZE);
+        // The pixel format can't change after this point so we pick the converter once instead of branching on it every frame
+        const FLibretroPixelConversion& PixelConversion = FLibretroPixelConversion::Get();
+        const bool bUnrealFramebufferIsBGRA = core.gl.pixel_format == GL_BGRA;
+        switch (core.gl.pixel_type) {
+            case GL_UNSIGNED_SHORT_5_6_5:
+                core.software.convert = bUnrealFramebufferIsBGRA ? PixelConversion.conv_rgb565_argb8888   : PixelConversion.conv_rgb565_abgr8888;
+                break;
+            case GL_UNSIGNED_SHORT_5_5_5_1:
+                core.software.convert = bUnrealFramebufferIsBGRA ? PixelConversion.conv_0rgb1555_argb8888 : PixelConversion.conv_0rgb1555_abgr8888;
+                break;
+            case GL_UNSIGNED_BYTE:
+                core.software.convert = bUnrealFramebufferIsBGRA ? PixelConversion.conv_copy              : PixelConversion.conv_argb8888_abgr8888;
+                break;
+            default:
+                checkNoEntry();
+        }
+
+        if (core.software.track_dirty_rows) {
+            core.software.dirty_rows.Initialize(geom->max_width, geom->max_height, sizeof(uint32));
         }
     }
-    
+
+    core.video_configured = true;
     core.hw.context_reset();
 }
 
+void FLibretroContext::video_reallocate(const struct retro_game_geometry *geom) {
+    UE_LOG(Libretro, Log, TEXT("Reallocating framebuffers for new max geometry %ux%u"), geom->max_width, geom->max_height);
+
+    // Without a render target (-nullrhi, dedicated servers) there's nothing to upload to so there's no mailbox, but the core still renders into everything else
+    if (Unreal.FrameMailbox) {
+        // The RHI thread could be reading from the old mailbox right now so we swap in a new one and free the old one after the uploader lets go of it
+        auto old_mailbox = Unreal.FrameMailbox;
+        Unreal.FrameMailbox = allocate_frame_mailbox(geom->max_width, geom->max_height);
+        FLibretroFrameUploader::Get().SetMailbox(Unreal.FrameUploadId, Unreal.FrameMailbox);
+        ENQUEUE_RENDER_COMMAND(LibretroFreeFrameMailbox)([old_mailbox](FRHICommandListImmediate& RHICmdList)
+            {
+                RHICmdList.EnqueueLambda([old_mailbox](FRHICommandList&)
+                    {
+                        free_frame_mailbox(old_mailbox);
+                    });
+            });
+    }
+
+    if (core.software.track_dirty_rows) {
+        core.software.dirty_rows.Free();
+        core.software.dirty_rows.Initialize(geom->max_width, geom->max_height, sizeof(uint32));
+    }
+
+    if (core.using_opengl) {
+        // @todo The render target's memory can't be resized out from under OpenGL. Not an issue for now since interop is never enabled
+        check(!core.gl.rhi_interop_memory);
+
+        // Whatever's still in flight was read from the old framebuffer. Just a few frames so we drop them rather than juggling pixel buffers of two sizes
+        for (unsigned i = 0; i < core.gl.readback_depth; i++) {
+            if (core.gl.readback[i].fence) {
+                glDeleteSync(core.gl.readback[i].fence);
+                core.gl.readback[i].fence = nullptr;
+            }
+        }
+        core.gl.readback_head = core.gl.readbacks_in_flight = 0;
+
+        // Respecifying the storage keeps the same names so the framebuffer the core holds onto stays valid
+        glBindTexture(GL_TEXTURE_2D, core.gl.texture);
+        LogGLErrors(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, geom->max_width,
+                                                             geom->max_height,
+                                                             0,
+                                                             core.gl.pixel_format,
+                                                             core.gl.pixel_type,
+                                                             NULL));
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        if (core.gl.renderbuffer) {
+            glBindRenderbuffer(GL_RENDERBUFFER, core.gl.renderbuffer);
+            glRenderbufferStorage(GL_RENDERBUFFER, core.gl.renderbuffer_format, geom->max_width,
+                                                                                geom->max_height);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, core.gl.framebuffer);
+        check(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        for (unsigned i = 0; i < core.gl.readback_depth; i++) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, core.gl.readback[i].pixel_buffer_object);
+            glBufferData(GL_PIXEL_PACK_BUFFER, 4 * geom->max_width * geom->max_height, 0, GL_DYNAMIC_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+}
+
+void FLibretroContext::resize_unreal_texture(unsigned width, unsigned height) {
+    Unreal.TextureWidth  = width;
+    Unreal.TextureHeight = height;
+
+    // ConsumeVideoState does the actual resize on the game thread right before ULibretroCoreInstance rebroadcasts OnCoreFrameBufferResize so UVs can be rescaled
+    publish_video_state();
+}
+
+void FLibretroContext::publish_video_state() {
+    FLibretroVideoState state;
+    state.BaseWidth         = core.av.geometry.base_width;
+    state.BaseHeight        = core.av.geometry.base_height;
+    state.Rotation          = core.rotation;
+    state.bBottomLeftOrigin = core.hw.bottom_left_origin;
+    state.TextureWidth      = Unreal.TextureWidth;
+    state.TextureHeight     = Unreal.TextureHeight;
+    state.PixelFormat       = UnrealPixelFormat;
+    state.FrameUploadId     = Unreal.FrameUploadId;
+
+    if (state == video_state) {
+        return; // Plenty of cores set the same geometry every frame
+    }
+
+    video_state = state;
+    VideoStateMailbox.GetWriteSlot() = state;
+    VideoStateMailbox.Publish(); // If the game thread hasn't picked up the last one this replaces it which is fine since it has everything
+}
+
+void FLibretroContext::publish_descriptions() {
+    DescriptionsMailbox.GetWriteSlot() = core.descriptions;
+    DescriptionsMailbox.Publish(); // Anything the game thread didn't pick up yet is older than this anyway
+}
+
+void FLibretroContext::ConsumeDescriptions()
+{
+    check(IsInGameThread()); // DescriptionsMailbox has a single consumer
+
+    if (FLibretroCoreDescriptions* Descriptions = DescriptionsMailbox.Acquire())
+    {   // The slot is ours until the next Acquire and the core overwrites whatever it finds in it so we can just take everything
+        OptionDescriptions     = MoveTemp(Descriptions->Options);
+        OptionSelectedIndex    = MoveTemp(Descriptions->OptionSelectedIndex);
+        ControllerDescriptions = MoveTemp(Descriptions->Controllers);
+    }
+}
+
+void FLibretroContext::SetOption(const FString& Key, const FString& Value)
+{
+    check(IsInGameThread());
+
+    const int32 Option = OptionDescriptions.IndexOfByPredicate([&Key](const FLibretroOptionDescription& Description) { return Description.Key == Key; });
+    if (Option == INDEX_NONE)
+    {
+        return;
+    }
+
+    const int32 Index = OptionDescriptions[Option].Values.IndexOfByKey(Value);
+    if (Index == INDEX_NONE)
+    {
+        UE_LOG(Libretro, Warning, TEXT("Value '%s' does not exist for option '%s'"), *Value, *Key);
+        return;
+    }
+
+    OptionSelectedIndex[Option] = Index;
+
+    // Looked up by key again since the core could have replaced its options by the time this runs
+    EnqueueTask([this, Key, Index](auto&&)
+        {
+            auto& options = core.descriptions.Options;
+            for (int i = 0; i < options.Num(); i++) {
+                if (options[i].Key == Key && Index < options[i].Values.Num()) {
+                    core.descriptions.OptionSelectedIndex[i] = Index;
+                    core.options_modified = true;
+                    publish_descriptions(); // Otherwise a publish from before this would undo it on the game thread
+                }
+            }
+        });
+}
+
+const FLibretroVideoState* FLibretroContext::ConsumeVideoState()
+{
+    check(IsInGameThread()); // VideoStateMailbox has a single consumer
+
+    const FLibretroVideoState* State = VideoStateMailbox.Acquire();
+    if (!State)
+    {
+        return nullptr;
+    }
+
+    UTextureRenderTarget2D* RenderTarget = UnrealRenderTarget.Get();
+    if (   RenderTarget
+        && State->TextureWidth && State->TextureHeight
+        && (   (unsigned)RenderTarget->SizeX != State->TextureWidth || (unsigned)RenderTarget->SizeY != State->TextureHeight
+            || RenderTarget->OverrideFormat != State->PixelFormat))
+    {
+        RenderTarget->InitCustomFormat(State->TextureWidth, State->TextureHeight, State->PixelFormat, false);
+
+        ENQUEUE_RENDER_COMMAND(LibretroResizeRHIFramebuffer)(
+            [Resource = static_cast<FTextureRenderTarget2DResource*>(RenderTarget->GameThread_GetRenderTargetResource()), FrameUploadId = State->FrameUploadId](FRHICommandListImmediate& RHICmdList)
+            {
+                FLibretroFrameUploader::Get().SetTexture(FrameUploadId, Resource->GetTextureRHI());
+            });
+    } // Otherwise the uploader just keeps clamping to the old texture
+
+    if (RenderTarget && State->TextureWidth && State->TextureHeight)
+    {
+        *bRenderTargetSized = true;
+    }
+
+    return State;
+}
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frames Dropped"), STAT_LibretroFramesDropped, STATGROUP_UnrealLibretro);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frames Duplicated"), STAT_LibretroFramesDuplicated, STATGROUP_UnrealLibretro);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frames Unchanged"), STAT_LibretroFramesUnchanged, STATGROUP_UnrealLibretro);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frames Late"), STAT_LibretroFramesLate, STATGROUP_UnrealLibretro);
+DECLARE_DWORD_COUNTER_STAT(TEXT("GPU Readback Bytes"), STAT_LibretroGPUReadbackBytes, STATGROUP_UnrealLibretro);
+DECLARE_DWORD_COUNTER_STAT(TEXT("GPU Readback Bytes Saved"), STAT_LibretroGPUReadbackBytesSaved, STATGROUP_UnrealLibretro); // Versus reading back the max geometry
+
 #include "Async/TaskGraphInterfaces.h"
 // Stripped down code for profiling purposes https://godbolt.org/z/c57esx
  void FLibretroContext::core_video_refresh(const void *data, unsigned width, unsigned height, unsigned pitch) {
     DECLARE_SCOPE_CYCLE_COUNTER(TEXT("PrepareFrameBufferForRenderThread"), STAT_LibretroPrepareFrameBufferForRenderThread, STATGROUP_UnrealLibretro);
 
-    unsigned SrcPitch = 4 * core.av.geometry.max_width;
-    
-    auto prepare_frame_for_upload_to_unreal_RHI = [&](void* const buffer)
+    if (!Unreal.FrameMailbox) {
+        return; // Rendering is disabled see video_configure
+    }
+
+    auto publish_frame_to_unreal_RHI = [&](const FLibretroFrame& Frame)
     {
-        void* old_buffer;
+        if (Frame.Width > Unreal.TextureWidth || Frame.Height > Unreal.TextureHeight)
         {
-            FScopeLock SwapPointer(&this->Unreal.FrameUpload.CriticalSection);
-            old_buffer = this->Unreal.FrameUpload.ClientBuffer;
-            this->Unreal.FrameUpload.ClientBuffer = buffer;
+            resize_unreal_texture(FMath::Max(Frame.Width,  Unreal.TextureWidth),
+                                  FMath::Max(Frame.Height, Unreal.TextureHeight));
         }
 
-        if (!old_buffer)
+        // FLibretroFrameUploader picks this up next render frame. If it hasn't gotten around to the last one we published that one is dropped
+        if (!this->Unreal.FrameMailbox->Publish())
         {
-            ENQUEUE_RENDER_COMMAND(CopyToUnrealFramebufferTask)( // @todo this triggers an assert on MacOS you can get around it by enqueuing through the TaskGraph instead no idea why this is the case
-                [this,
-                MipIndex = 0,
-                SrcPitch,
-                Region = FUpdateTextureRegion2D(0, 0, 0, 0, width, height)]
-            (FRHICommandListImmediate& RHICmdList)
-            {
-                check(this->Unreal.TextureRHI.GetReference());
-
-                RHICmdList.EnqueueLambda([=, this](FRHICommandList& RHICmdList)
-                    {
-                        // Potentially this should be a TryLock() so you don't preempt the render thread although it's unlikely that would happen
-                        FScopeLock UploadTextureToRenderHardware(&this->Unreal.FrameUpload.CriticalSection);
-                        GDynamicRHI->RHIUpdateTexture2D(
-#if    ENGINE_MAJOR_VERSION == 5 \
-    && ENGINE_MINOR_VERSION >= 2
-                            RHICmdList,
-#endif
-                            this->Unreal.TextureRHI.GetReference(),
-                            MipIndex,
-                            Region,
-                            SrcPitch,
-                            (uint8*)this->Unreal.FrameUpload.ClientBuffer);
-                        this->Unreal.FrameUpload.ClientBuffer = nullptr;
-                    }
-                );
-            }
-            );
+            FramesDropped.fetch_add(1, std::memory_order_relaxed);
+            INC_DWORD_STAT(STAT_LibretroFramesDropped);
         }
     };
     
     if (data && data != RETRO_HW_FRAME_BUFFER_VALID) {
         DECLARE_SCOPE_CYCLE_COUNTER(TEXT("CPUConvertAndCopyFramebuffer"), STAT_LibretroCPUConvertAndCopyFramebuffer, STATGROUP_UnrealLibretro);
         
-        auto bgra_buffer = core.software.bgra_buffers[core.free_framebuffer_index = !core.free_framebuffer_index];
-
-        if (core.gl.pixel_format == GL_BGRA) {
-        switch (core.gl.pixel_type) {
-            case GL_UNSIGNED_SHORT_5_6_5: {
-                conv_rgb565_argb8888(bgra_buffer, data,
-                    width, height,
-                    SrcPitch, pitch);
-            }
-            break;
-            case GL_UNSIGNED_SHORT_5_5_5_1: {
-                checkNoEntry();
+        FLibretroFrame& Frame = Unreal.FrameMailbox->GetWriteSlot();
+        Frame.Width  = width;
+        Frame.Height = height;
+
+        // The core drew straight into our buffer using RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER so it's already in Unreal's format
+        const bool zero_copy = data == Frame.Buffer;
+        if (zero_copy && pitch != Frame.Pitch) {
+            // The core drew into our buffer with some other pitch. Converting it in place would read rows we've already overwritten so the frame is dropped
+            static std::atomic<bool> logged{false};
+            if (!logged.exchange(true)) {
+                UE_LOG(Libretro, Warning, TEXT("A core presented the software framebuffer we gave it with pitch %llu instead of %u. Frames like that are dropped"), (uint64)pitch, Frame.Pitch);
             }
-            break;
-            case GL_UNSIGNED_BYTE: {
-                conv_copy(bgra_buffer, data,
-                    width, height,
-                    SrcPitch, pitch);
+
+            FramesDropped.fetch_add(1, std::memory_order_relaxed);
+            INC_DWORD_STAT(STAT_LibretroFramesDropped);
+            return;
+        }
+
+        if (core.software.track_dirty_rows) {
+            const uint64 sequence = core.software.dirty_rows.Update(data, width, height, pitch, zero_copy ? sizeof(uint32) : core.gl.bits_per_pixel);
+
+            // The buffer still holds whatever frame it had last time it was written so we only convert what changed since then
+            if (!zero_copy) {
+                core.software.dirty_rows.ForEachChangedRun(Frame.Sequence, [&](unsigned y, unsigned rows)
+                    {
+                        core.software.convert((uint8*)Frame.Buffer + y * Frame.Pitch, (const uint8*)data + y * pitch,
+                            width, rows,
+                            Frame.Pitch, pitch);
+                    });
             }
-            break;
-            default:
-                checkNoEntry();
+            Frame.Sequence = sequence;
+
+            // Likewise the texture holds whatever frame was uploaded last
+            Frame.NumDirtyRegions = core.software.dirty_rows.GetChangedRegions(Unreal.FrameSource.UploadedSequence.load(std::memory_order_acquire), Frame.DirtyRegions);
+            if (Frame.NumDirtyRegions == 0) {
+                INC_DWORD_STAT(STAT_LibretroFramesUnchanged);
+                return;
             }
         } else {
-            switch (core.gl.pixel_type) {
-            case GL_UNSIGNED_SHORT_5_6_5: {
-                conv_rgb565_abgr8888(bgra_buffer, data,
-                    width, height,
-                    SrcPitch, pitch);
-            }
-            break;
-            case GL_UNSIGNED_BYTE: {
-                conv_argb8888_abgr8888(bgra_buffer, data,
+            if (!zero_copy) {
+                core.software.convert(Frame.Buffer, data,
                     width, height,
-                    SrcPitch, pitch);
-            }
-            break;
-            default:
-                checkNoEntry();
+                    Frame.Pitch, pitch);
             }
+
+            Frame.Sequence = ++core.frame_sequence;
+            Frame.NumDirtyRegions = 1;
+            Frame.DirtyRegions[0] = { 0, height };
         }
 
-        prepare_frame_for_upload_to_unreal_RHI(bgra_buffer);
+        publish_frame_to_unreal_RHI(Frame);
     }
     else if (data == RETRO_HW_FRAME_BUFFER_VALID) {
         check(core.using_opengl && core.gl.pixel_type == GL_UNSIGNED_BYTE);
@@ -553,72 +953,135 @@ static bool GLLogCall(const char* function, const char* file, int line)
         // if we try reading the framebuffer we'll block here and consequently the framerate will be capped by Unreal Engines framerate
         // which will cause stuttering if its too low since most emulated games logic is tied to the framerate so we async copy the framebuffer and check a fence later
 
-            switch (glClientWaitSync(core.gl.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0)) {
-                case GL_TIMEOUT_EXPIRED:
-                    UE_LOG(Libretro, Verbose, TEXT("Frame didn't render in time will try copying next time..."))
-                        break;
-                case GL_ALREADY_SIGNALED:
-                case GL_CONDITION_SATISFIED:
-                {
-                    DECLARE_SCOPE_CYCLE_COUNTER(TEXT("GPUAsyncCopy"), STAT_LibretroGPUAsyncCopy, STATGROUP_UnrealLibretro);
-                    { // Hand off previously copied frame to Unreal
-                        glBindBuffer(GL_PIXEL_PACK_BUFFER, core.gl.pixel_buffer_objects[!core.free_framebuffer_index]);
-
-                        void* frame_buffer = glMapBufferRange(GL_PIXEL_PACK_BUFFER,
-                                                              0, // Offset
-                                                              4 * core.av.geometry.max_width * core.av.geometry.max_height,
-                                                              GL_MAP_READ_BIT);
-                        check(frame_buffer);
-                        prepare_frame_for_upload_to_unreal_RHI(frame_buffer);
-                    }
+            DECLARE_SCOPE_CYCLE_COUNTER(TEXT("GPUAsyncCopy"), STAT_LibretroGPUAsyncCopy, STATGROUP_UnrealLibretro);
 
-                    { // Download Libretro Core frame from OpenGL asynchronously
-                        LogGLErrors(glBindFramebuffer(GL_READ_FRAMEBUFFER, core.gl.framebuffer));
-                        LogGLErrors(glBindBuffer(GL_PIXEL_PACK_BUFFER, core.gl.pixel_buffer_objects[core.free_framebuffer_index]));
-                        LogGLErrors(glReadBuffer(GL_COLOR_ATTACHMENT0));
-                        verify(glUnmapBuffer(GL_PIXEL_PACK_BUFFER) == GL_TRUE);
-                        { // Async copy bound framebuffer color component into bound pbo
-                            GLint mip_level = 0;
-                            void* offset_into_pbo_where_data_is_written = 0x0;
-                            // This call is async always and a DMA transfer on most platforms
-                            LogGLErrors(glReadPixels(0, 0,
-                                core.av.geometry.max_width, // @enhancement Only copy the portion of the buffer we need rather than the max possible potential size
-                                core.av.geometry.max_height,
-                                core.gl.pixel_format,
-                                core.gl.pixel_type,
-                                offset_into_pbo_where_data_is_written));
-                        }
-                        glDeleteSync(core.gl.fence);
-                        core.gl.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-                    }
+            auto oldest_index = [this]() { return (core.gl.readback_head + core.gl.readback_depth - core.gl.readbacks_in_flight) % core.gl.readback_depth; };
 
-                    core.free_framebuffer_index = !core.free_framebuffer_index;
+            if (core.gl.readbacks_in_flight == core.gl.readback_depth
+                && glClientWaitSync(core.gl.readback[oldest_index()].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+                // Every pixel buffer is in use so rather than dropping a frame we wait for the GPU to catch up
+                DECLARE_SCOPE_CYCLE_COUNTER(TEXT("GPUReadbackStall"), STAT_LibretroGPUReadbackStall, STATGROUP_UnrealLibretro);
+                FramesLate.fetch_add(1, std::memory_order_relaxed);
+                INC_DWORD_STAT(STAT_LibretroFramesLate);
 
-                    LogGLErrors(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-                    LogGLErrors(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+                const GLuint64 one_second_in_nanoseconds = 1000 * 1000 * 1000;
+                GLenum status;
+                do {
+                    status = glClientWaitSync(core.gl.readback[oldest_index()].fence, GL_SYNC_FLUSH_COMMANDS_BIT, one_second_in_nanoseconds);
+                } while (status == GL_TIMEOUT_EXPIRED);
+                check(status != GL_WAIT_FAILED);
+            }
+
+            // Fences signal in order so every copy that's finished is at the front. Normally we hand off just the oldest so every frame is delivered in order.
+            // When skipping to the newest, the rest of them are dropped so after a GPU hiccup we're back down to one copy in flight right away
+            // instead of staying however many frames behind the hiccup left us
+            const unsigned readbacks_to_check = core.gl.readback_skip_to_newest ? core.gl.readbacks_in_flight : FMath::Min(1u, core.gl.readbacks_in_flight);
+            unsigned readbacks_ready = 0;
+            while (readbacks_ready < readbacks_to_check) {
+                const unsigned index = (oldest_index() + readbacks_ready) % core.gl.readback_depth;
+                const GLenum status = glClientWaitSync(core.gl.readback[index].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+                check(status != GL_WAIT_FAILED);
+                if (status == GL_TIMEOUT_EXPIRED) {
                     break;
                 }
-                case GL_WAIT_FAILED:
-                default:
-                    checkNoEntry();
+                readbacks_ready++;
+            }
+
+            if (readbacks_ready == 0 && core.gl.readbacks_in_flight) {
+                UE_LOG(Libretro, VeryVerbose, TEXT("Frame didn't render in time will try copying next time..."))
+            }
+
+            for (; readbacks_ready > 1; readbacks_ready--) {
+                auto& skipped = core.gl.readback[oldest_index()];
+                glDeleteSync(skipped.fence);
+                skipped.fence = nullptr;
+                core.gl.readbacks_in_flight--;
+
+                FramesDropped.fetch_add(1, std::memory_order_relaxed);
+                INC_DWORD_STAT(STAT_LibretroFramesDropped);
+            }
+
+            if (readbacks_ready) { // Hand off the copied frame to Unreal
+                auto& ready = core.gl.readback[oldest_index()];
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, ready.pixel_buffer_object);
+
+                FLibretroFrame& Frame = Unreal.FrameMailbox->GetWriteSlot();
+                Frame.Width  = ready.width;
+                Frame.Height = ready.height;
+                Frame.Sequence = ++core.frame_sequence;
+                Frame.NumDirtyRegions = 1;
+                Frame.DirtyRegions[0] = { 0, ready.height };
+
+                // We copy out of the pixel buffer rather than handing the mapping to the RHI thread so we can unmap right away
+                // and the RHI thread never holds onto memory OpenGL owns
+                const unsigned packed_pitch = 4 * ready.width;
+                const uint8* frame_buffer = (const uint8*)glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+                                                                            0, // Offset
+                                                                            packed_pitch * ready.height,
+                                                                            GL_MAP_READ_BIT);
+                check(frame_buffer);
+                if (packed_pitch == Frame.Pitch) {
+                    FMemory::Memcpy(Frame.Buffer, frame_buffer, packed_pitch * ready.height);
+                } else {
+                    for (unsigned y = 0; y < ready.height; y++) {
+                        FMemory::Memcpy((uint8*)Frame.Buffer + y * Frame.Pitch, frame_buffer + y * packed_pitch, packed_pitch);
+                    }
+                }
+                verify(glUnmapBuffer(GL_PIXEL_PACK_BUFFER) == GL_TRUE);
+
+                glDeleteSync(ready.fence);
+                ready.fence = nullptr;
+                core.gl.readbacks_in_flight--;
+
+                publish_frame_to_unreal_RHI(Frame);
             }
+
+            { // Download Libretro Core frame from OpenGL asynchronously
+                check(core.gl.readbacks_in_flight < core.gl.readback_depth);
+                auto& current = core.gl.readback[core.gl.readback_head];
+                current.width  = width;
+                current.height = height;
+
+                LogGLErrors(glBindFramebuffer(GL_READ_FRAMEBUFFER, core.gl.framebuffer));
+                LogGLErrors(glBindBuffer(GL_PIXEL_PACK_BUFFER, current.pixel_buffer_object));
+                LogGLErrors(glReadBuffer(GL_COLOR_ATTACHMENT0));
+                { // Async copy bound framebuffer color component into bound pbo
+                    void* offset_into_pbo_where_data_is_written = 0x0;
+                    // This call is async always and a DMA transfer on most platforms. We only read what the core presented
+                    // which is packed tightly into the pixel buffer (GL_PACK_ROW_LENGTH is 0 and rows of RGBA8 always satisfy GL_PACK_ALIGNMENT)
+                    LogGLErrors(glReadPixels(0, 0,
+                        width,
+                        height,
+                        core.gl.pixel_format,
+                        core.gl.pixel_type,
+                        offset_into_pbo_where_data_is_written));
+                }
+                INC_DWORD_STAT_BY(STAT_LibretroGPUReadbackBytes, 4 * width * height);
+                INC_DWORD_STAT_BY(STAT_LibretroGPUReadbackBytesSaved, 4 * (core.av.geometry.max_width * core.av.geometry.max_height - width * height));
+
+                current.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                core.gl.readback_head = (core.gl.readback_head + 1) % core.gl.readback_depth;
+                core.gl.readbacks_in_flight++;
+            }
+
+            LogGLErrors(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+            LogGLErrors(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
         }
     }
     else {
         // *Duplicate frame*
+        FramesDuplicated.fetch_add(1, std::memory_order_relaxed);
+        INC_DWORD_STAT(STAT_LibretroFramesDuplicated);
         return;
     }
 }
 
 size_t FLibretroContext::core_audio_write(const int16_t *buf, size_t frames) {
-    unsigned FramesEnqueued = 0;
-    while (FramesEnqueued < frames && Unreal.AudioQueue->Enqueue(((int32*)buf)[FramesEnqueued])) {
-        FramesEnqueued++;
-    }
+    // Nudges the rate to keep the queue half full so the core's clock and the audio device's clock can't drift apart
+    auto Resampled = core.audio.resampler.Resample(buf, frames, Unreal.AudioQueue->GetBufferedFrames(), Unreal.AudioQueue->GetTargetFrames());
 
-    if (FramesEnqueued != frames) {
-        UE_LOG(Libretro, Verbose, TEXT("Buffer underrun: %u"), frames - FramesEnqueued);
-    }
+    // One memcpy and one publish for the whole batch. Whatever doesn't fit under the buffer's target is dropped and counted as an overrun
+    Unreal.AudioQueue->Enqueue(Resampled.GetData(), Resampled.Num() / 2);
 
     return frames;
 
@@ -652,27 +1115,23 @@ static void core_log(enum retro_log_level level, const char *fmt, ...) {
 }
 
 bool FLibretroContext::core_environment(unsigned cmd, void *data) {
-    bool delegate_status{false};
-    if (CoreEnvironmentCallback)
-    {
-        delegate_status = CoreEnvironmentCallback(cmd, data);
-    }
-    
     switch (cmd) {
     case RETRO_ENVIRONMENT_GET_VARIABLE: {
         retro_variable* var = (struct retro_variable*)data;
 
+        const auto& options = core.descriptions.Options;
+
         int i = 0;
-        for (FString TargetKey = FString(var->key); i < OptionDescriptions.Num(); i++) {
-            if (OptionDescriptions[i].Key == TargetKey) break;
+        for (FString TargetKey = FString(var->key); i < options.Num(); i++) {
+            if (options[i].Key == TargetKey) break;
         }
 
-        if (i == OptionDescriptions.Num()) {
+        if (i == options.Num()) {
             UE_LOG(Libretro, Warning, TEXT ("Core '%s' violated libretro spec asked for unkown option '%s'"), UTF8_TO_TCHAR(system.library_name), UTF8_TO_TCHAR(var->key));
             return false;
         }
         
-        FString TargetValue = OptionDescriptions[i].Values[OptionSelectedIndex[i].load(std::memory_order_relaxed)];
+        FString TargetValue = options[i].Values[core.descriptions.OptionSelectedIndex[i]];
         
         int32 Utf8Length = FTCHARToUTF8_Convert::ConvertedLength(*TargetValue, TargetValue.Len());
         TArray<char>& TargetValueCString = OptionsCache.FindOrAdd(var->key);
@@ -686,42 +1145,44 @@ bool FLibretroContext::core_environment(unsigned cmd, void *data) {
     case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE: {
         bool* core_should_query_for_options = (bool*)data;
 
-        // atomic<>::exchange is necessary otherwise we could miss newly set options because of a race condition
-        *core_should_query_for_options = OptionsHaveBeenModified.exchange(false, std::memory_order_acquire);
+        // Options are only ever changed on this thread by the tasks SetOption enqueues
+        *core_should_query_for_options = core.options_modified;
+        core.options_modified = false;
 
         return true;
     }
     case RETRO_ENVIRONMENT_SET_VARIABLES: {
-        // Queuing this and synchronizing on the game thread prevents a data race
-        FTaskGraphInterface::Get().WaitUntilTaskCompletes(FFunctionGraphTask::CreateAndDispatchWhenReady([this, data]() 
-            { 
-                OptionDescriptions = FUnrealLibretroModule::EnvironmentParseOptions((const struct retro_variable*)data);
+        // We build these here and hand the game thread a copy so neither side ever waits on the other
+        auto& options = core.descriptions.Options;
+        options = FUnrealLibretroModule::EnvironmentParseOptions((const struct retro_variable*)data);
 
-                if (OptionSelectedIndex.Num() > 0 && OptionSelectedIndex.Num() != OptionDescriptions.Num()) {
-                    UE_LOG(Libretro, Warning, TEXT("Core violated libretro spec size of Options changed"));
-                }
+        auto& selected = core.descriptions.OptionSelectedIndex;
+        if (selected.Num() > 0 && selected.Num() != options.Num()) {
+            UE_LOG(Libretro, Warning, TEXT("Core violated libretro spec size of Options changed"));
+        }
 
-                // By libretro spec the 0 index setting is the default one
-                OptionSelectedIndex.SetNumZeroed(OptionDescriptions.Num(), false);
-            }, 
-            TStatId(), nullptr, ENamedThreads::GameThread));
+        // By libretro spec the 0 index setting is the default one
+        selected.Reset();
+        selected.SetNumZeroed(options.Num());
 
-        for (int i = 0; i < OptionDescriptions.Num(); i++)
+        for (int i = 0; i < options.Num(); i++)
         {
-            if (FString* TargetValue = StartingOptions.Find(OptionDescriptions[i].Key))
+            if (FString* TargetValue = StartingOptions.Find(options[i].Key))
             {
-                auto TargetIndex = OptionDescriptions[i].Values.IndexOfByKey(*TargetValue);
+                auto TargetIndex = options[i].Values.IndexOfByKey(*TargetValue);
 
                 if (TargetIndex == INDEX_NONE)
                 {
-                    UE_LOG(Libretro, Warning, TEXT("Value '%s' does not exist for option '%s'"), **TargetValue, *OptionDescriptions[i].Key);
+                    UE_LOG(Libretro, Warning, TEXT("Value '%s' does not exist for option '%s'"), **TargetValue, *options[i].Key);
                     continue;
                 }
 
-                OptionSelectedIndex[i].store(TargetIndex, std::memory_order_relaxed);
+                selected[i] = TargetIndex;
             }
         }
 
+        publish_descriptions();
+
         return true;
     }
     case RETRO_ENVIRONMENT_GET_LOG_INTERFACE: {
@@ -734,6 +1195,28 @@ bool FLibretroContext::core_environment(unsigned cmd, void *data) {
         *bval = true;
         return true;
     }
+    case RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER: {
+        struct retro_framebuffer *framebuffer = (struct retro_framebuffer *)data;
+
+        // We can only hand out the buffer we upload from if the core can draw straight into Unreal's pixel format.
+        // Libretro doesn't have a format matching the OpenGL RHI's RGBA so it always has to go through conversion
+        if (   core.using_opengl
+            || core.gl.pixel_format != GL_BGRA
+            || !Unreal.FrameMailbox
+            || framebuffer->width  > core.av.geometry.max_width
+            || framebuffer->height > core.av.geometry.max_height)
+            return false;
+
+        FLibretroFrame& Frame = Unreal.FrameMailbox->GetWriteSlot();
+
+        framebuffer->data         = Frame.Buffer;
+        framebuffer->pitch        = Frame.Pitch;
+        framebuffer->format       = RETRO_PIXEL_FORMAT_XRGB8888; // Allowed to differ from SET_PIXEL_FORMAT. core_video_refresh skips conversion when it gets this buffer back
+        framebuffer->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+
+        Frame.Sequence = 0; // The core can scribble over this without ever presenting it so we no longer know what frame's in it
+        return true;
+    }
     case RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME: {
         libretro_api.supports_no_game = *(bool*)data;
         return true;
@@ -782,7 +1265,7 @@ bool FLibretroContext::core_environment(unsigned cmd, void *data) {
     case RETRO_ENVIRONMENT_SET_HW_RENDER: {
         struct retro_hw_render_callback *hw = (struct retro_hw_render_callback*)data;
         check(hw->context_type < RETRO_HW_CONTEXT_VULKAN);
-        hw->get_current_framebuffer = libretro_callbacks->c_get_current_framebuffer;
+        hw->get_current_framebuffer = dispatch_get_current_framebuffer;
 #pragma warning(push)
 #pragma warning(disable:4191)
         hw->get_proc_address = (retro_hw_get_proc_address_t)GL_GET_PROC_ADDRESS;
@@ -795,14 +1278,48 @@ bool FLibretroContext::core_environment(unsigned cmd, void *data) {
 
         return true;
     }
+    case RETRO_ENVIRONMENT_SET_GEOMETRY: {
+        auto geometry = (const struct retro_game_geometry*)data;
+
+        // Max geometry can't change here per the libretro spec so nothing has to be reallocated
+        core.av.geometry.base_width   = geometry->base_width;
+        core.av.geometry.base_height  = geometry->base_height;
+        core.av.geometry.aspect_ratio = geometry->aspect_ratio;
+        publish_video_state();
+
+        return true;
+    }
+    case RETRO_ENVIRONMENT_SET_ROTATION: {
+        core.rotation = *(const unsigned*)data;
+        publish_video_state();
+
+        return true;
+    }
     case RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO: {
         auto system_av_info = *(const struct retro_system_av_info*)data;
 
-        check(   system_av_info.geometry.max_height <= core.av.geometry.max_height  // @todo buffer reallocation. The libretro core can basically request to reallocate framebuffers atm this requires writing code to potentially reallocate 4 buffers
-              && system_av_info.geometry.max_width  <= core.av.geometry.max_width); // in the case of software rendering the client buffer in opengl the pbo and texture buffer and in both cases the unreal engine rhi buffer on top of this there are
-                                                                                    // annoying synchonization issues to deal with. We just assert here so we don't actually have to do that for now
+        const bool max_geometry_grew =    system_av_info.geometry.max_width  > core.av.geometry.max_width
+                                       || system_av_info.geometry.max_height > core.av.geometry.max_height;
+
+        // We never shrink our buffers, they just end up with some slack. The render target is sized separately by what's actually presented
+        system_av_info.geometry.max_width  = FMath::Max(system_av_info.geometry.max_width,  core.av.geometry.max_width);
+        system_av_info.geometry.max_height = FMath::Max(system_av_info.geometry.max_height, core.av.geometry.max_height);
+        this->core.av = system_av_info;
 
-        this->core.av.timing = system_av_info.timing;
+        if (core.av.timing.sample_rate > 0) {
+            flush_audio_samples(); // They're at the old rate
+            core.audio.resampler.SetInputSampleRate(core.av.timing.sample_rate);
+        }
+
+        if (core.av.timing.fps > 0.0) {
+            FramePacer.SetFramesPerSecond(core.av.timing.fps);
+        }
+
+        if (max_geometry_grew && core.video_configured) { // Otherwise video_configure allocates for the new max geometry in the first place
+            video_reallocate(&core.av.geometry);
+        }
+
+        publish_video_state();
 
         return true;
     }
@@ -851,9 +1368,8 @@ bool FLibretroContext::core_environment(unsigned cmd, void *data) {
         return true;
     }
     case RETRO_ENVIRONMENT_SET_CONTROLLER_INFO: {
-        FTaskGraphInterface::Get().WaitUntilTaskCompletes(FFunctionGraphTask::CreateAndDispatchWhenReady([this, data]()
-            { ControllerDescriptions = FUnrealLibretroModule::EnvironmentParseControllerInfo((const struct retro_controller_info*)data);  },
-            TStatId(), nullptr, ENamedThreads::GameThread));
+        core.descriptions.Controllers = FUnrealLibretroModule::EnvironmentParseControllerInfo((const struct retro_controller_info*)data);
+        publish_descriptions();
 
         return true;
     }
@@ -882,6 +1398,13 @@ bool FLibretroContext::core_environment(unsigned cmd, void *data) {
 
         return false;
     }
+    case RETRO_ENVIRONMENT_GET_INPUT_BITMASKS: {
+        // Lets the core fetch all of a port's buttons with one retro_input_state call instead of one per button. Some cores pass null here
+        if (data) {
+            *(bool*)data = true;
+        }
+        return true;
+    }
     case RETRO_ENVIRONMENT_GET_FASTFORWARDING: {
         auto is_fast_forwarding = (bool*)data;
         *is_fast_forwarding = false;
@@ -891,14 +1414,11 @@ bool FLibretroContext::core_environment(unsigned cmd, void *data) {
         return false;
     }
     default:
-        if (!delegate_status) {
         core_log(RETRO_LOG_WARN, "Unhandled env #%u", cmd);
-        }
-        
-        return delegate_status;
+        return false;
     }
 
-    return delegate_status;
+    return false;
 }
 
 // Unfinished experiment with less branchy version of this function https://godbolt.org/z/hYeYxr95r
@@ -915,11 +1435,17 @@ int16_t FLibretroContext::core_input_state(unsigned port, unsigned device, unsig
     // - Some cores will not poll for any input by default (I fix this by always binding the RETRO_DEVICE_JOYPAD)
     // - The RETRO_DEVICE_POINTER interface is generally preferred over the lightgun and mouse even for things like lightguns and mice although you still use some parts of the lightgun interface for handling lightgun input probably same goes for mouse
 
+    if (!LatchedInput || port >= PortCount) {
+        return 0;
+    }
+
+    const FLibretroInputState& InputState = LatchedInput->Ports[port];
     switch (device & RETRO_DEVICE_MASK) {
-    case RETRO_DEVICE_JOYPAD:   return InputState[port][to_integral(ERetroDeviceID::JoypadB)     + id];
-    case RETRO_DEVICE_LIGHTGUN: return InputState[port][to_integral(ERetroDeviceID::LightgunX)   + id];
-    case RETRO_DEVICE_ANALOG:   return InputState[port][to_integral(ERetroDeviceID::AnalogLeftX) + 2 * index + (id % RETRO_DEVICE_ID_JOYPAD_L2)]; // The indexing logic is broken and might OOBs if we're queried for something that isn't an analog trigger or stick
-    case RETRO_DEVICE_POINTER:  return InputState[port][to_integral(ERetroDeviceID::PointerX)    + 4 * index + id];
+    case RETRO_DEVICE_JOYPAD:   return id == RETRO_DEVICE_ID_JOYPAD_MASK ? LatchedInput->JoypadMasks[port]
+                                                                         : InputState.Data[to_integral(ERetroDeviceID::JoypadB) + id];
+    case RETRO_DEVICE_LIGHTGUN: return InputState.Data[to_integral(ERetroDeviceID::LightgunX)   + id];
+    case RETRO_DEVICE_ANALOG:   return InputState.Data[to_integral(ERetroDeviceID::AnalogLeftX) + 2 * index + (id % RETRO_DEVICE_ID_JOYPAD_L2)]; // The indexing logic is broken and might OOBs if we're queried for something that isn't an analog trigger or stick
+    case RETRO_DEVICE_POINTER:  return InputState.Data[to_integral(ERetroDeviceID::PointerX)    + 4 * index + id];
     case RETRO_DEVICE_MOUSE:
     case RETRO_DEVICE_KEYBOARD:
     default:                    return 0;
@@ -927,12 +1453,34 @@ int16_t FLibretroContext::core_input_state(unsigned port, unsigned device, unsig
 }
 
 
+void FLibretroContext::core_input_poll() {
+    // Whatever the game thread published last is what the core sees until it polls again
+    if (const FLibretroInputSnapshot* Snapshot = InputMailbox.Acquire()) {
+        LatchedInput = Snapshot;
+    }
+}
+
 void FLibretroContext::core_audio_sample(int16_t left, int16_t right) {
-    int16_t buf[2] = {left, right};
-    core_audio_write(buf, (size_t)1);
+    core.audio.samples[core.audio.num_samples++] = left;
+    core.audio.samples[core.audio.num_samples++] = right;
+    core.audio.frames_sampled++;
+
+    if (core.audio.num_samples == sizeof(core.audio.samples) / sizeof(core.audio.samples[0])) {
+        flush_audio_samples();
+    }
+}
+
+void FLibretroContext::flush_audio_samples() {
+    if (core.audio.num_samples == 0) {
+        return;
+    }
+
+    core_audio_write(core.audio.samples, core.audio.num_samples / 2);
+    core.audio.num_samples = 0;
+    core.audio.sample_flushes++;
 }
 
-void FLibretroContext::load(const char *sofile) {
+bool FLibretroContext::load(const char *sofile) {
     void (*set_environment)(retro_environment_t) = NULL;
     void (*set_video_refresh)(retro_video_refresh_t) = NULL;
     void (*set_input_poll)(retro_input_poll_t) = NULL;
@@ -940,10 +1488,12 @@ void FLibretroContext::load(const char *sofile) {
     void (*set_audio_sample)(retro_audio_sample_t) = NULL;
     void (*set_audio_sample_batch)(retro_audio_sample_batch_t) = NULL;
     
-    libretro_api.handle = FPlatformProcess::GetDllHandle(ANSI_TO_TCHAR(sofile));
+    libretro_api.handle = FLibretroCoreLibrary::Get().Load(UTF8_TO_TCHAR(sofile));
 
-    if (!libretro_api.handle)
-        UE_LOG(LogTemp, Fatal ,TEXT("Failed to load core: %s"), ANSI_TO_TCHAR(sofile));
+    if (!libretro_api.handle) {
+        UE_LOG(Libretro, Warning, TEXT("Failed to load core: %s"), UTF8_TO_TCHAR(sofile));
+        return false;
+    }
 
     load_retro_sym(init);
     load_retro_sym(deinit);
@@ -968,23 +1518,25 @@ void FLibretroContext::load(const char *sofile) {
     load_sym(set_audio_sample, retro_set_audio_sample);
     load_sym(set_audio_sample_batch, retro_set_audio_sample_batch);
 
-    libretro_callbacks->video_refresh = [this](const void* data, unsigned width, unsigned height, size_t pitch) { return core_video_refresh(data, width, height, pitch); };
-    libretro_callbacks->audio_write = [this](const int16_t *data, size_t frames) { return core_audio_write(data, frames); };
-    libretro_callbacks->audio_sample = [this](int16_t left, int16_t right) { return core_audio_sample(left, right); };
-    libretro_callbacks->input_state = [this](unsigned port, unsigned device, unsigned index, unsigned id) { return core_input_state(port, device, index, id); };
-    libretro_callbacks->input_poll = [=]() { };
-    libretro_callbacks->environment = [this](unsigned cmd, void* data) { return core_environment(cmd, data); };
-     libretro_callbacks->get_current_framebuffer = [this]() { return core.gl.framebuffer; };
-
-    set_environment(libretro_callbacks->c_environment);
-    set_video_refresh(libretro_callbacks->c_video_refresh);
-    set_input_poll(libretro_callbacks->c_input_poll);
-    set_input_state(libretro_callbacks->c_input_state);
-    set_audio_sample(libretro_callbacks->c_audio_sample);
-    set_audio_sample_batch(libretro_callbacks->c_audio_write);
+    check(current_context == this);
+
+    {
+        FRWScopeLock scoped_lock(core_modules_lock, SLT_Write);
+        core_modules.Add(module_base((const void*)libretro_api.init), this);
+        core_modules_generation.fetch_add(1, std::memory_order_release);
+    }
+
+    set_environment(dispatch_environment);
+    set_video_refresh(dispatch_video_refresh);
+    set_input_poll(dispatch_input_poll);
+    set_input_state(dispatch_input_state);
+    set_audio_sample(dispatch_audio_sample);
+    set_audio_sample_batch(dispatch_audio_write);
 
     libretro_api.init();
     libretro_api.initialized = true;
+
+    return true;
 }
 
 
@@ -1003,6 +1555,10 @@ void FLibretroContext::load_game(const char* filename) {
         UE_LOG(Libretro, Fatal, TEXT("The core failed to load the content."));
 
     libretro_api.get_system_av_info(&core.av);
+
+    if (core.av.timing.sample_rate > 0) {
+        core.audio.resampler.SetInputSampleRate(core.av.timing.sample_rate);
+    }
      
     if (core.using_opengl) {
 // SDL State isn't threadlocal like OpenGL so we have to synchronize here when we create a window
@@ -1020,6 +1576,7 @@ void FLibretroContext::load_game(const char* filename) {
     }
 
     video_configure(&core.av.geometry);
+    publish_video_state(); // The render target is already the right size but the game thread hasn't heard about any of the rest yet
 }
 
 FLibretroContext* FLibretroContext::Launch(ULibretroCoreInstance* LibretroCoreInstance, FString core, FString game, UTextureRenderTarget2D* RenderTarget, URawAudioSoundWave* SoundBuffer, TUniqueFunction<void(FLibretroContext*, libretro_api_t&)> LoadedCallback)
@@ -1027,19 +1584,8 @@ FLibretroContext* FLibretroContext::Launch(ULibretroCoreInstance* LibretroCoreIn
 
     check(IsInGameThread()); // So static initialization is safe + UObject access
 
-    static constexpr uint32 max_instances = sizeof(libretro_callbacks_table) / sizeof(libretro_callbacks_table[0]);
-    static TBitArray<TInlineAllocator<(max_instances / 8) + 1>> AllocatedInstances(false, max_instances);
-
     FLibretroContext *l = new FLibretroContext();
 
-    // Grab a statically generated callback structure
-    int32 InstanceNumber;
-    {
-        InstanceNumber = AllocatedInstances.FindAndSetFirstZeroBit();
-        check(InstanceNumber != INDEX_NONE);
-        l->libretro_callbacks = libretro_callbacks_table + InstanceNumber;
-    }
-
     auto ConvertPath = [](auto &core_directory, const FString& CoreDirectory)
     {
         FString AbsoluteCoreDirectory = IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(*FUnrealLibretroModule::IfRelativeResolvePathRelativeToThisPluginWithPathExtensions(CoreDirectory));
@@ -1054,6 +1600,18 @@ FLibretroContext* FLibretroContext::Launch(ULibretroCoreInstance* LibretroCoreIn
 
     ConvertPath(l->core.save_directory,   LibretroSettings->CoreSaveDirectory);
     ConvertPath(l->core.system_directory, LibretroSettings->CoreSystemDirectory);
+
+    l->core.software.track_dirty_rows = LibretroSettings->bUploadOnlyChangedRows;
+    l->core.gl.readback_depth = FMath::Clamp<unsigned>(LibretroSettings->HardwareReadbackDepth, 2, MaxReadbackDepth);
+    l->core.gl.readback_skip_to_newest = LibretroSettings->bHardwareReadbackSkipToNewest;
+
+    l->Unreal.AudioBufferMilliseconds    = FMath::Max(1, LibretroCoreInstance->AudioBufferMilliseconds > 0 ? LibretroCoreInstance->AudioBufferMilliseconds
+                                                                                                           : LibretroSettings->AudioBufferMilliseconds);
+    l->Unreal.AudioBufferMaxMilliseconds = LibretroSettings->bAdaptiveAudioBuffer ? FMath::Max<uint32>(l->Unreal.AudioBufferMilliseconds, LibretroSettings->AdaptiveAudioBufferMaxMilliseconds)
+                                                                                  : l->Unreal.AudioBufferMilliseconds;
+    l->Unreal.MaxAudioFramesPerCallback  = FMath::Max(0, LibretroSettings->MaxAudioFramesPerCallback);
+
+    l->FramePacer.Configure(FMath::Max(0, LibretroSettings->MaxCatchUpFrames));
     
     l->StartingOptions = LibretroSettings->GlobalCoreOptions;
     l->StartingOptions.Append(LibretroCoreInstance->EditorPresetOptions); // Potentially overrides global options
@@ -1061,29 +1619,74 @@ FLibretroContext* FLibretroContext::Launch(ULibretroCoreInstance* LibretroCoreIn
     l->UnrealRenderTarget = MakeWeakObjectPtr(RenderTarget);
     l->UnrealSoundBuffer  = MakeWeakObjectPtr(SoundBuffer );
 
-    // Kick the initialization process off to another thread. It shouldn't be added to the Unreal task pool because those are too slow and my code relies on OpenGL state being thread local.
-    // The Runnable system is the standard way for spawning and managing threads in Unreal. FThread looks enticing, but they removed any way to detach threads since "it doesn't work as expected"
-    l->LambdaRunnable = FLambdaRunnable::RunLambdaOnBackGroundThread(FPaths::GetCleanFilename(core) + FPaths::GetCleanFilename(game),
-        [=, LoadedCallback = MoveTemp(LoadedCallback), EditorPresetControllers = LibretroCoreInstance->EditorPresetControllers]() {
+    l->LaunchRequestedSeconds = FPlatformTime::Seconds();
 
-            // Here I load a copy of the dll instead of the original. If you load the same dll multiple times you won't obtain a new instance of the dll loaded into memory,
-            // instead all variables and function pointers will point to the original loaded dll
-            // WARNING: Don't ever even try to load the original dll since the editor needs to load it to query core settings (This can happen when you pause in PIE!)
-            const FString InstancedCorePath = IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(
-#if PLATFORM_ANDROID
-                // On Android .so's have to be copied to your private application directory before they are loaded
-                // @enhancement Use dlmopen and package files in private application directory then you wouldn't have to copy the dll every time https://man.archlinux.org/man/dlmopen.3.en#:~:text=LM_ID_NEWLM,is%20initially%0A%20%20%20%20%20%20empty
-                //              Although this solution would be limited to 16 'namespaces' which is probably enough for practical purposes but not great
-                *FString::Printf(TEXT("/data/data/%s/files/%s.%s"), *FAndroidPlatformProcess::GetGameBundleId(), *FGuid::NewGuid().ToString(), *FPaths::GetExtension(*core))
-#else
-                *FString::Printf(TEXT("%s.%s"), *FGuid::NewGuid().ToString(), *FPaths::GetExtension(*core))
-#endif
-            );
+    // Kick the initialization process off to one of FLibretroScheduler's workers. It shouldn't be added to the Unreal task pool because those are too slow and my code relies on OpenGL state being thread local.
+    // The scheduler's workers are our own so a core using OpenGL can pin itself to the one it created its context on
+    l->SchedulerJob = FLibretroScheduler::Get().Schedule(
+        [=, LoadedCallback = MoveTemp(LoadedCallback), EditorPresetControllers = LibretroCoreInstance->EditorPresetControllers, bWasParked = false](FLibretroScheduler::FJob& Job) mutable {
+
+            FScopedCurrentContext ScopedCurrentContext(l); // So the core's callbacks come back to us
+
+            // The first step starts the core up and every step after that runs a frame
+            if (l->CoreState.load(std::memory_order_relaxed) != ECoreState::Starting)
+            {
+                DECLARE_SCOPE_CYCLE_COUNTER(TEXT("Frame"), STAT_LibretroFrame, STATGROUP_UnrealLibretro);
+
+                if (l->core.using_opengl)
+                {
+                    l->make_gl_context_current();
+                }
+
+                {
+                    DECLARE_SCOPE_CYCLE_COUNTER(TEXT("Work"), STAT_LibretroWork, STATGROUP_UnrealLibretro);
+
+                    if (l->CoreState.load(std::memory_order_relaxed) == ECoreState::Running)
+                    {
+                        l->FramePacer.BeginFrame();
+                        l->libretro_api.run();
+                        l->flush_audio_samples();
+                    }
+                    
+                    // Execute tasks from command queue  Note: It's semantically significant that this is here. Since I hook in save state
+                    //                                         operations here it must necessarily come after run is called on the core
+                    // If the core failed to start there's nothing for them to call into, so only the shutdown task gets run
+                    l->LibretroAPITasks.RunAll(l->libretro_api, l->CoreState.load(std::memory_order_relaxed) == ECoreState::StartFailed);
+                }
 
-            uint64 frames = 0;
-            auto   start = FDateTime::Now();
+                switch (l->CoreState.load(std::memory_order_relaxed))
+                {
+                case ECoreState::Shutdown:
+                    goto cleanup;
+                case ECoreState::StartFailed:
+                case ECoreState::Paused:
+                    // Nothing to do until EnqueueTask wakes us up with something to do
+                    Job.Park();
+                    bWasParked = true;
+                    return;
+                default:
+                    if (bWasParked)
+                    {   // Otherwise we'd count however long we were paused as falling behind
+                        l->FramePacer.Restart();
+                        bWasParked = false;
+                    }
+
+                    Job.RunAt(l->FramePacer.ScheduleNextFrame());
+                    return;
+                }
+            }
 
-            verify(IPlatformFile::GetPlatformPhysical().CopyFile(*InstancedCorePath, *core));
+            // Nothing gets loaded until FLibretroLaunchQueue says it's our turn, then it wakes us
+            if (!l->bLaunchAdmitted.load(std::memory_order_acquire))
+            {
+                if (l->bShutdownRequested.load(std::memory_order_acquire))
+                {
+                    goto cleanup; // Shut down before it ever got its turn. There's nothing to clean up but the context itself
+                }
+
+                Job.Park();
+                return;
+            }
 
             l->core.hw.version_major = 4;
             l->core.hw.version_minor = 5;
@@ -1091,8 +1694,13 @@ FLibretroContext* FLibretroContext::Launch(ULibretroCoreInstance* LibretroCoreIn
             l->core.hw.context_reset = []() {};
             l->core.hw.context_destroy = []() {};
 
-            // Loads the dll and its function pointers into libretro_api
-            l->load(TCHAR_TO_UTF8(*InstancedCorePath));
+            // Loads a fresh instance of the dll and its function pointers into libretro_api. If you load the same dll multiple times you won't obtain a new instance
+            // of the dll loaded into memory, instead all variables and function pointers will point to the original loaded dll. See FLibretroCoreLibrary for how we get around that
+            if (!l->load(TCHAR_TO_UTF8(*core)))
+            {
+                l->CoreState.store(ECoreState::StartFailed, std::memory_order_release);
+                goto start_failed;
+            }
 
             l->libretro_api.get_system_info(&l->system);
             for (int Port = 0; Port < PortCount; Port++)
@@ -1111,68 +1719,35 @@ FLibretroContext* FLibretroContext::Launch(ULibretroCoreInstance* LibretroCoreIn
             {
                 UE_LOG(Libretro, Warning, TEXT("Failed to launch Libretro core '%s'. Path given for ROM was empty"), *core);
                 l->CoreState.store(ECoreState::StartFailed, std::memory_order_release);
-                goto cleanup;
+                goto start_failed;
             }
 
             // This does load the game but does many other things as well. If hardware rendering is needed it loads OpenGL resources from the OS and this also initializes the unreal engine resources for audio and video.
             l->load_game(game.IsEmpty() ? nullptr : TCHAR_TO_UTF8(*game));
         
-            l->CoreState.store(ECoreState::Running, std::memory_order_release);
-            LoadedCallback(l, l->libretro_api);
-            
-            // This simplifies the logic in core_video_refresh, It stops us from erroring when we try to unmap this pixel buffer in core_video_refresh
-            // You could just move this to the beginning of core_video_refresh and surround it with an if statement that does this the first time through
-            if (l->core.using_opengl) {
-                l->glBindBuffer(GL_PIXEL_PACK_BUFFER, l->core.gl.pixel_buffer_objects[l->core.free_framebuffer_index]);
-                l->glMapBufferRange(GL_PIXEL_PACK_BUFFER,
-                                    0, // Offset
-                                    1, // Size... 
-                                    GL_MAP_READ_BIT);
-                l->core.gl.fence = l->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-                l->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-            }
+            l->FramePacer.SetFramesPerSecond(l->core.av.timing.fps > 0.0 ? l->core.av.timing.fps : 60.0);
 
-            while (l->CoreState.load(std::memory_order_relaxed) != ECoreState::Shutdown)
+            if (l->core.using_opengl)
             {
-                DECLARE_SCOPE_CYCLE_COUNTER(TEXT("Frame"), STAT_LibretroFrame, STATGROUP_UnrealLibretro);
-                {
-                    DECLARE_SCOPE_CYCLE_COUNTER(TEXT("Work"), STAT_LibretroWork, STATGROUP_UnrealLibretro);
+                Job.PinToCurrentWorker(); // OpenGL contexts are thread local
+            }
 
-                    if (l->CoreState.load(std::memory_order_relaxed) == ECoreState::Running)
-                    {
-                        l->libretro_api.run();
-                    }
-                    
-                    // Execute tasks from command queue  Note: It's semantically significant that this is here. Since I hook in save state
-                    //                                         operations here it must necessarily come after run is called on the core
-                    TUniqueFunction<void(libretro_api_t&)> Task;
-                    while (l->LibretroAPITasks.Dequeue(Task)) 
-                    {
-                        Task(l->libretro_api);
-                    }
-                }
-                
-                { // @todo My timing solution is a bit adhoc. I'm sure theres probably a better way.
-                    DECLARE_SCOPE_CYCLE_COUNTER(TEXT("Sleep"), STAT_LibretroSleep, STATGROUP_UnrealLibretro);
+            l->CoreState.store(ECoreState::Running, std::memory_order_release);
+            l->notify_launch_finished();
+            LoadedCallback(l, l->libretro_api);
 
-                    frames++;
+            Job.RunAt(FPlatformTime::Cycles64());
+            return;
 
-                    double sleep = (frames / l->core.av.timing.fps) - (FDateTime::Now() - start).GetTotalSeconds();
-                    if (sleep > 0.0) {
-                        FPlatformProcess::Sleep(sleep); // This always yields so only call it when we actually need to sleep
-                    } else if (sleep < -(1 / l->core.av.timing.fps)) { // If over a frame behind don't try to catch up to the next frame
-                        start = FDateTime::Now();
-                        frames = 0;
-                    }
-                }
-            }
+start_failed:
+            // The context is still the game thread's until it calls Shutdown, so we stick around until then instead of cleaning up now
+            l->notify_launch_finished();
+            LoadedCallback(l, l->libretro_api);
 
-cleanup:
-            if (l->CoreState.load(std::memory_order_relaxed) == ECoreState::StartFailed)
-            {
-                LoadedCallback(l, l->libretro_api);
-            }
+            Job.Park();
+            return;
 
+cleanup:
             if (l->libretro_api.initialized)
             {
                 l->libretro_api.deinit();
@@ -1180,17 +1755,26 @@ cleanup:
             
             if (l->libretro_api.handle)
             {
-                FPlatformProcess::FreeDllHandle(l->libretro_api.handle);
-            }
+                {
+                    FRWScopeLock scoped_lock(core_modules_lock, SLT_Write);
+                    core_modules.Remove(module_base((const void*)l->libretro_api.init));
+                    core_modules_generation.fetch_add(1, std::memory_order_release);
+                }
 
-            IPlatformFile::GetPlatformPhysical().DeleteFile(*InstancedCorePath);
+                FLibretroCoreLibrary::Get().Free(l->libretro_api.handle);
+            }
 
             l->Unreal.AudioQueue.Reset();
-            
-            FFunctionGraphTask::CreateAndDispatchWhenReady([=]
-            {
-                AllocatedInstances[InstanceNumber] = false;
-            }, TStatId(), nullptr, ENamedThreads::GameThread);
+
+            UE_LOG(Libretro, Verbose, TEXT("'%s' dropped %llu frames, duplicated %llu frames, and waited on the GPU for %llu frames"), *core,
+                                                                                                                             l->FramesDropped.load(std::memory_order_relaxed),
+                                                                                                                             l->FramesDuplicated.load(std::memory_order_relaxed),
+                                                                                                                             l->FramesLate.load(std::memory_order_relaxed));
+            UE_LOG(Libretro, Verbose, TEXT("'%s' delivered %llu audio frames through retro_audio_sample_batch and %llu through retro_audio_sample, which we wrote in %llu batches"), *core,
+                                                                                                                             l->core.audio.frames_batched,
+                                                                                                                             l->core.audio.frames_sampled,
+                                                                                                                             l->core.audio.sample_flushes);
+            UE_LOG(Libretro, Verbose, TEXT("'%s' turned away %llu tasks because its command queue was full"), *core, l->LibretroAPITasks.GetRejectedCount());
             
             {
 #if PLATFORM_WINDOWS
@@ -1201,7 +1785,25 @@ cleanup:
                     verify(ReleaseDC(l->core.gl.window, l->core.gl.hdc));
                     verify(DestroyWindow(l->core.gl.window));
                 }
+#elif PLATFORM_ANDROID || PLATFORM_LINUX
+                // Otherwise the context can't actually be destroyed since it'd still be current on this worker
+                if (l->core.gl.egl_context)
+                {
+                    eglMakeCurrent(l->core.gl.egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+                }
 #endif
+                if (current_gl_context == l)
+                {
+                    current_gl_context = nullptr;
+                }
+
+                l->core.software.dirty_rows.Free();
+
+                if (l->Unreal.FrameUploadId)
+                {
+                    FLibretroFrameUploader::Get().Unregister(l->Unreal.FrameUploadId); // Has to be enqueued before the mailbox is freed below
+                }
+
                 // The double nested command enqueue is based on boilerplate I found elsewhere in the engine
                 // Since render commands are executed fifo we only delete shared resources after the render thread is done with them
                 // The actual render command execution is done on the RHI thread so we have to synchronize there as well
@@ -1209,19 +1811,13 @@ cleanup:
                     {
                         RHICmdList.EnqueueLambda([l](FRHICommandList&)
                             {
-                                for (int i : {0, 1})
-                                {
-                                    if (l->core.software.bgra_buffers[i])
-                                    {
-                                        FMemory::Free(l->core.software.bgra_buffers[i]);
-                                    }
-                                }
+                                free_frame_mailbox(l->Unreal.FrameMailbox);
 #if PLATFORM_WINDOWS
                                 if (l->core.gl.context)
                                 {
                                     wglDeleteContext(l->core.gl.context); /** implicitly releases resources like fbos, pbos, and textures */
                                 }
-#elif PLATFORM_ANDROID
+#elif PLATFORM_ANDROID || PLATFORM_LINUX
                                 if (l->core.gl.egl_context) 
                                 {
                                     verify(eglDestroyContext(l->core.gl.egl_display, 
@@ -1229,13 +1825,6 @@ cleanup:
                                 }
 #endif
 
-                                l->Unreal.TextureRHI.SafeRelease();
-                            
-                                if (l->LambdaRunnable)
-                                {
-                                    delete l->LambdaRunnable; /** This will block the render thread if for some reason the thread we were running on hasn't exited yet */
-                                }
-                            
                                 delete l; /** Task queue released */
                             });
                     }
@@ -1244,16 +1833,51 @@ cleanup:
         }
     );
 
+    FLibretroLaunchQueue::Get().Enqueue(l, LibretroCoreInstance);
+
     return l;
 }
 
+void FLibretroContext::AdmitLaunch()
+{
+    check(IsInGameThread());
+
+    LaunchAdmittedSeconds = FPlatformTime::Seconds();
+    bLaunchAdmitted.store(true, std::memory_order_release);
+    FLibretroScheduler::Get().Wake(SchedulerJob);
+}
+
+void FLibretroContext::notify_launch_finished() {
+    const double QueuedSeconds  = LaunchAdmittedSeconds - LaunchRequestedSeconds;
+    const double LoadingSeconds = FPlatformTime::Seconds() - LaunchAdmittedSeconds;
+
+    UE_LOG(Libretro, Verbose, TEXT("'%s' waited %.1fms for its turn to launch then took %.1fms to load"), system.library_name ? UTF8_TO_TCHAR(system.library_name) : TEXT("?"), QueuedSeconds * 1000.0, LoadingSeconds * 1000.0);
+
+    FFunctionGraphTask::CreateAndDispatchWhenReady([QueuedSeconds, LoadingSeconds]()
+        {
+            FLibretroLaunchQueue::Get().NotifyLaunchFinished(QueuedSeconds, LoadingSeconds);
+        }, TStatId(), nullptr, ENamedThreads::GameThread);
+}
+
 void FLibretroContext::Shutdown(FLibretroContext* Instance) 
 {
+    check(IsInGameThread());
+
+    // Only the game thread admits launches so once it's out of the queue whether it was admitted can't change under us
+    FLibretroLaunchQueue::Get().Cancel(Instance);
+    if (!Instance->bLaunchAdmitted.load(std::memory_order_acquire))
+    {   // It never got its turn so it won't ever run any tasks. Its job cleans up once it sees this, which can delete Instance as soon as it's woken
+        auto Job = Instance->SchedulerJob;
+        Instance->bShutdownRequested.store(true, std::memory_order_release);
+        FLibretroScheduler::Get().Wake(Job);
+        return;
+    }
+
     // We enqueue the shutdown procedure as the final task since we want outstanding tasks to be executed first
     Instance->EnqueueTask([Instance](auto&&)
         {
             Instance->CoreState.store(ECoreState::Shutdown, std::memory_order_relaxed);
-        });
+        }, true);
 }
 
 void FLibretroContext::Pause(bool ShouldPause)
@@ -1270,8 +1894,79 @@ void FLibretroContext::Pause(bool ShouldPause)
     
 }
 
-void FLibretroContext::EnqueueTask(TUniqueFunction<void(libretro_api_t&)> LibretroAPITask)
+void FLibretroContext::PublishInputState()
 {
-    check(IsInGameThread()); // LibretroAPITasks is a single producer single consumer queue
-    LibretroAPITasks.Enqueue(MoveTemp(LibretroAPITask));
-};
+    check(IsInGameThread()); // InputMailbox has a single producer
+
+    FLibretroInputSnapshot& Snapshot = InputMailbox.GetWriteSlot();
+    FMemory::Memcpy(Snapshot.Ports, InputState, sizeof(InputState));
+
+    for (int Port = 0; Port < PortCount; Port++)
+    {
+        uint16 Mask = 0;
+        for (int Button = RETRO_DEVICE_ID_JOYPAD_B; Button <= RETRO_DEVICE_ID_JOYPAD_R3; Button++)
+        {
+            Mask |= (InputState[Port][to_integral(ERetroDeviceID::JoypadB) + Button] != 0) << Button;
+        }
+        Snapshot.JoypadMasks[Port] = (int16_t)Mask;
+    }
+
+    InputMailbox.Publish();
+}
+
+
+#if !UE_BUILD_SHIPPING
+#include "HAL/IConsoleManager.h"
+
+// Calls a callback shaped like retro_audio_sample_t the way cores call us, through a function pointer, dispatched both ways we've done it.
+// The static trampoline indexing a table of TUniqueFunction's that capture this like we used to do for up to 100 cores, and looking the context up
+// in a thread local like we do now
+namespace libretro_dispatch_benchmark {
+    struct FTarget {
+        uint64 Sum = 0;
+        FORCENOINLINE void callback(int16_t left, int16_t right) { Sum += left + right; }
+    };
+
+    static TUniqueFunction<void(int16_t, int16_t)> table[100];
+    static void trampoline(int16_t left, int16_t right) { table[42](left, right); }
+
+    static thread_local FTarget* current = nullptr;
+    static void dispatch(int16_t left, int16_t right) { current->callback(left, right); }
+}
+
+static FAutoConsoleCommand GLibretroCallbackDispatchBenchmark(
+    TEXT("Libretro.BenchmarkCallbackDispatch"),
+    TEXT("Compares the overhead of dispatching libretro callbacks through static trampolines and through a thread local context. Optional argument is the number of calls in millions (default 100)"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+    {
+        using namespace libretro_dispatch_benchmark;
+
+        const uint64 Calls = (Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100) * 1000000ull;
+
+        FTarget Target;
+        table[42] = [&Target](int16_t left, int16_t right) { Target.callback(left, right); };
+        current = &Target;
+
+        auto Time = [&](const TCHAR* Name, retro_audio_sample_t Callback)
+        {
+            retro_audio_sample_t volatile Opaque = Callback; // So the compiler can't see through the call like it can't for a real core
+
+            const double Start = FPlatformTime::Seconds();
+            for (uint64 i = 0; i < Calls; i++)
+            {
+                Opaque((int16_t)i, 1);
+            }
+            const double Elapsed = FPlatformTime::Seconds() - Start;
+
+            UE_LOG(Libretro, Display, TEXT("%-24s %8.2f ms  %5.2f ns/call"), Name, Elapsed * 1000.0, Elapsed * 1e9 / Calls);
+        };
+
+        Time(TEXT("Trampoline table"), trampoline);
+        Time(TEXT("Thread local context"), dispatch);
+
+        table[42] = nullptr;
+        current = nullptr;
+
+        UE_LOG(Libretro, Verbose, TEXT("Checksum %llu"), Target.Sum); // So the calls can't be optimized out
+    }));
+#endif
@@ -12,12 +12,19 @@ static_assert(RETRO_API_VERSION == 1, "Retro API version changed");
 #include "CoreMinimal.h"
 #include "Engine/TextureRenderTarget2D.h"
 #include "UObject/WeakObjectPtrTemplates.h"
-#include "Containers/CircularQueue.h"
-#include "Containers/Queue.h"
 #include "RHIResources.h"
 
 #include "LibretroInputDefinitions.h"
 #include "RawAudioSoundWave.h"
+#include "LibretroPixelConversion.h"
+#include "LibretroFrameUploader.h"
+#include "LibretroDirtyRows.h"
+#include "LibretroAudioQueue.h"
+#include "LibretroAudioResampler.h"
+#include "LibretroFramePacer.h"
+#include "LibretroScheduler.h"
+#include "LibretroMailbox.h"
+#include "LibretroCommandQueue.h"
 
 #if PLATFORM_WINDOWS
 #include "Windows/AllowWindowsPlatformTypes.h"
@@ -100,11 +107,54 @@ struct libretro_api_t {
     retro_keyboard_event_t keyboard_event;
 };
 
+struct FLibretroInputSnapshot
+{
+    FLibretroInputState Ports[PortCount];
+    int16_t JoypadMasks[PortCount]; // Bit i is RETRO_DEVICE_ID_JOYPAD i. Packed when published so RETRO_DEVICE_ID_JOYPAD_MASK queries are just a load
+};
+
+/** Everything about the core's output the game thread has to keep up with. The core republishes all of it whenever any of it changes */
+struct FLibretroVideoState
+{
+    unsigned     BaseWidth{0};
+    unsigned     BaseHeight{0};
+    unsigned     Rotation{0}; // In counter-clockwise quarter turns, see RETRO_ENVIRONMENT_SET_ROTATION
+    bool         bBottomLeftOrigin{false};
+
+    // The render target has to be grown to this before anyone looks at the rest
+    unsigned     TextureWidth{0};
+    unsigned     TextureHeight{0};
+    EPixelFormat PixelFormat{PF_Unknown};
+    uint32       FrameUploadId{0};
+
+    bool operator==(const FLibretroVideoState& Other) const
+    {
+        return    BaseWidth         == Other.BaseWidth
+               && BaseHeight        == Other.BaseHeight
+               && Rotation          == Other.Rotation
+               && bBottomLeftOrigin == Other.bBottomLeftOrigin
+               && TextureWidth      == Other.TextureWidth
+               && TextureHeight     == Other.TextureHeight
+               && PixelFormat       == Other.PixelFormat
+               && FrameUploadId     == Other.FrameUploadId;
+    }
+};
+
+/** What the core told us about its options and controllers. The core builds these on its own thread and hands the game thread a copy */
+struct FLibretroCoreDescriptions
+{
+    TArray<FLibretroOptionDescription> Options;
+    TArray<uint8> OptionSelectedIndex; // Into each option's Values. By libretro spec the 0 index is the default
+    TStaticArray<TArray<FLibretroControllerDescription>, PortCount> Controllers;
+};
+
 struct FLibretroContext {
 public:
     /**
      * @brief analogous to new except asynchronous
-     * @post The LoadedCallback is always called
+     *
+     * The core doesn't actually start loading until FLibretroLaunchQueue gives it its turn, but the context can be used like normal in the meantime
+     * @post The LoadedCallback is always called unless the context is shut down before it got its turn
      */
     static FLibretroContext* Launch(class ULibretroCoreInstance* LibretroCoreInstance, FString core, FString game, UTextureRenderTarget2D* RenderTarget, URawAudioSoundWave* SoundEmitter, TUniqueFunction<void(FLibretroContext*, libretro_api_t&)> LoadedCallback);
     
@@ -113,34 +163,95 @@ public:
      */
     static void Shutdown(FLibretroContext* Instance);
 
+    /** Called by FLibretroLaunchQueue when it's this context's turn to load its core */
+    void AdmitLaunch();
+
     /**
      * Queued tasks will still execute even if paused
      */
     void Pause(bool ShouldPause);
     
     /**
+     * Queues a call into the core's API to be run on its thread after its next frame. Safe to call from any thread as long as the context is still alive
+     *
+     * Never allocates. Whatever the task captures is stored inline in the command queue so it has to fit in CommandInlineBytes
+     * @param bRunEvenIfStartFailed Otherwise the task is dropped if the core failed to start since libretro_api has nothing loaded behind it
+     * @return false if the command queue is full. The task is dropped in that case
+     */
+    template<typename TaskType>
+    bool TryEnqueueTask(TaskType&& LibretroAPITask, bool bRunEvenIfStartFailed = false)
+    {
+        auto Job = SchedulerJob; // Once the task is enqueued this could be deleted out from under us, i.e. if it's the task Shutdown enqueues
+        if (!LibretroAPITasks.TryEnqueue(Forward<TaskType>(LibretroAPITask), bRunEvenIfStartFailed))
+        {
+            return false;
+        }
+
+        FLibretroScheduler::Get().Wake(Job); // In case we're paused
+        return true;
+    }
+
+    /**
+     * Like TryEnqueueTask except if the command queue is full it waits for the core to make room instead of dropping the task
+     *
+     * Until FLibretroLaunchQueue lets the core launch nothing drains the queue, and that can only happen on the game thread, so until then
+     * a full queue drops the task like TryEnqueueTask does rather than waiting forever
+     * @param bRunEvenIfStartFailed Otherwise the task is dropped if the core failed to start since libretro_api has nothing loaded behind it
      * @post Everything queued before calling shutdown will be executed
      */
-    void EnqueueTask(TUniqueFunction<void(libretro_api_t&)> LibretroAPITask);
+    template<typename TaskType>
+    void EnqueueTask(TaskType&& LibretroAPITask, bool bRunEvenIfStartFailed = false)
+    {
+        auto Job = SchedulerJob;
+        while (!LibretroAPITasks.TryEnqueue(Forward<TaskType>(LibretroAPITask), bRunEvenIfStartFailed)) // A failed TryEnqueue leaves the task untouched so we can keep trying with it
+        {
+            if (!bLaunchAdmitted.load(std::memory_order_acquire))
+            {
+                return; // Counted as rejected like any other task that didn't fit
+            }
+
+            FLibretroScheduler::Get().Wake(Job);
+            FPlatformProcess::SleepNoStats(0.f);
+        }
+
+        FLibretroScheduler::Get().Wake(Job);
+    }
+
+    static constexpr uint32 CommandQueueCapacity = 256;
+    static constexpr SIZE_T CommandInlineBytes   = 64;
 
     /**
-     * This is what the libretro core reads from when determining input. If you want to use your own input method you can modify this directly.
+     * The input the game thread is building up for the core. If you want to use your own input method you can modify this directly.
+     * None of it reaches the core until PublishInputState is called, then the core picks up everything at once the next time it polls for input
      */
     FLibretroInputState InputState[PortCount];
+    void PublishInputState();
+
+    /**
+     * Game thread: Picks up whatever the core changed about its output since the last call, resizing the render target first if the core outgrew it
+     *
+     * However many times the core changed things in between, only the newest state is handed back
+     * @return nullptr if nothing changed. Otherwise the new state which stays valid until the next call
+     */
+    const FLibretroVideoState* ConsumeVideoState();
 
-    std::atomic<bool> OptionsHaveBeenModified;
-    TArray<std::atomic<uint8>> OptionSelectedIndex;
     TMap<FString, FString> StartingOptions;
 
-    // The following are always safe to access from the game thread and are guranteed to be initialized after exiting the starting state
+    // The following are the game thread's copies of what the core told us. They're caught up by ConsumeDescriptions which runs before OnLaunchComplete is broadcast and every tick after
     TArray<FLibretroOptionDescription> OptionDescriptions;
+    TArray<uint8> OptionSelectedIndex;
     TStaticArray<TArray<struct FLibretroControllerDescription>, PortCount> ControllerDescriptions;
+
+    /** Game thread: Takes the newest descriptions the core published if there are any */
+    void ConsumeDescriptions();
+
+    /** Game thread: Takes effect on the game thread's copy right away and the core sees it after its next frame */
+    void SetOption(const FString& Key, const FString& Value);
+
     decltype(retro_controller_description::id) DeviceIDs[PortCount]; // The core doesn't keep track of this so we have to
 
     struct retro_system_info system = { 0 };
 
-    TUniqueFunction<TRemovePointer<retro_environment_t>::Type> CoreEnvironmentCallback;
-
     /**
      * @brief Describes the state of the core we're executing
      * 
@@ -154,6 +265,8 @@ public:
      *   +-------------+       +-----------+       +-----------+
      *   | StartFailed |       |  Paused   |------>|  Shutdown |
      *   +-------------+       +-----------+       +-----------+
+     *        |                                          ^
+     *        +------------------------------------------+
      */
     enum class ECoreState : int8
     {
@@ -168,40 +281,75 @@ public:
 
     EPixelFormat UnrealPixelFormat{PF_B8G8R8A8};
 
+    /** Paces the libretro thread. Its stats are safe to read from any thread */
+    FLibretroFramePacer FramePacer;
+
 protected:
     FLibretroContext() {}
     ~FLibretroContext() {}
 
     libretro_api_t        libretro_api = { 0 };
-    struct libretro_callbacks_t* libretro_callbacks = nullptr;
-    TQueue<TUniqueFunction<void(libretro_api_t&)>, EQueueMode::Spsc> LibretroAPITasks; // TQueue<T, EQueueMode::Spsc> has acquire-release semantics on Enqueue and Dequeue so this should be thread-safe
+    TLibretroCommandQueue<libretro_api_t&, CommandQueueCapacity, CommandInlineBytes> LibretroAPITasks;
+
+    // The game thread publishes whole input states here and the core latches the newest one each time it polls for input
+    TLibretroMailbox<FLibretroInputSnapshot> InputMailbox;
+    const FLibretroInputSnapshot* LatchedInput{nullptr}; // Libretro thread only. Stays valid until the next time we latch
+
+    // The core publishes here when its output changes and ULibretroCoreInstance picks it up once a tick, so a core that
+    // sets the same geometry every frame costs nothing and one that keeps changing it costs one update per tick at most
+    TLibretroMailbox<FLibretroVideoState> VideoStateMailbox;
+    FLibretroVideoState video_state; // Libretro thread only. What was last published
+
+    TLibretroMailbox<FLibretroCoreDescriptions> DescriptionsMailbox;
+
+    double LaunchRequestedSeconds{0.0};
+    double LaunchAdmittedSeconds{0.0};                     // Written before bLaunchAdmitted is set
+    std::atomic<bool> bLaunchAdmitted{false};
+    std::atomic<bool> bShutdownRequested{false};
 
     // @todo remove these and have the loaded callback handle these resources
     TWeakObjectPtr<UTextureRenderTarget2D> UnrealRenderTarget{nullptr};
     TWeakObjectPtr<URawAudioSoundWave> UnrealSoundBuffer{nullptr};
 
+    // Game thread: Set once ConsumeVideoState has sized the render target so video_configure's init task doesn't size it back down to the base geometry if it runs late.
+    // Shared since that task can outlive us
+    TSharedRef<bool, ESPMode::ThreadSafe> bRenderTargetSized{MakeShared<bool, ESPMode::ThreadSafe>(false)};
+
     TMap<FString, TArray<char>> OptionsCache; // This isn't technically needed in theory a core should immediately convert an option into it's internal representation and cease referencing 
                                               // the string before control flow is passed back to you, but the lifetime of a string passed to a core when it uses RETRO_ENVIRONMENT_GET_VARIABLE 
                                               // isn't well defined in the libretro spec, so some cores like mame will misbehave if you free a string before it's done with it
 
     struct
     {
-        // These are all ThreadSafe shared pointers that are the main bridge between and unreal
-        FTexture2DRHIRef TextureRHI;
-        TSharedPtr<TCircularQueue<int32>, ESPMode::ThreadSafe> AudioQueue;
+        // Shared with the sound wave which is how the audio gets to Unreal
+        TSharedPtr<FLibretroAudioQueue, ESPMode::ThreadSafe> AudioQueue;
+        uint32 AudioBufferMilliseconds;
+        uint32 AudioBufferMaxMilliseconds; // Same as AudioBufferMilliseconds unless the buffer is adaptive
+        uint32 MaxAudioFramesPerCallback;
         
-        struct
-        {
-            FCriticalSection CriticalSection;
-            void* ClientBuffer{ nullptr };
-        } FrameUpload;
+        // The libretro thread publishes frames here and FLibretroFrameUploader takes the newest one once per render frame, neither side ever blocks
+        // The mailbox is sized for the max geometry so it's replaced if the core asks for a bigger one
+        TLibretroMailbox<FLibretroFrame>* FrameMailbox;
+        FLibretroFrameSource FrameSource;
+        uint32 FrameUploadId;
+
+        // What we last asked the render target to be sized to. It starts at the base geometry and grows when the core presents something bigger
+        unsigned TextureWidth;
+        unsigned TextureHeight;
     } Unreal = {0};
 
+    std::atomic<uint64> FramesDropped{0};    // Published over before FLibretroFrameUploader got to it
+    std::atomic<uint64> FramesDuplicated{0}; // The core told us nothing changed since the last frame
+    std::atomic<uint64> FramesLate{0};       // We had to wait on the GPU for a hardware rendered frame
+
+    static constexpr unsigned MaxReadbackDepth = 4;
+
     struct {
         bool using_opengl;
+        bool video_configured; // Once video_configure has allocated everything video_reallocate resizes
         
         struct {
-#if PLATFORM_ANDROID
+#if PLATFORM_ANDROID || PLATFORM_LINUX
             void* egl_context;
             void* egl_display;
 #elif PLATFORM_WINDOWS
@@ -213,10 +361,20 @@ protected:
             GLuint texture;
             GLuint framebuffer;
             GLuint renderbuffer;
+            GLenum renderbuffer_format;
             GLuint rhi_interop_memory;
 
-            GLuint pixel_buffer_objects[2];
-            GLsync fence;
+            // Ring of asynchronous framebuffer reads. The oldest is handed to Unreal once its fence signals
+            struct {
+                GLuint pixel_buffer_object;
+                GLsync fence;
+                unsigned width; // Dimensions of the frame read into the pixel buffer
+                unsigned height;
+            } readback[MaxReadbackDepth];
+            unsigned readback_depth;
+            bool readback_skip_to_newest; // Drop every finished copy but the newest instead of delivering them one per frame, see ULibretroSettings
+            unsigned readback_head;       // Where the next read goes
+            unsigned readbacks_in_flight;
 
             GLuint pitch;
             GLuint pixel_type;
@@ -225,32 +383,61 @@ protected:
         } gl;
 
         struct {
-            void* bgra_buffers[2];
+            libretro_pixel_conversion_t convert; // From the core's pixel format into UnrealPixelFormat
+
+            bool track_dirty_rows;
+            FLibretroDirtyRows dirty_rows;
         } software;
 
-        bool free_framebuffer_index;
+        uint64 frame_sequence; // Only used when we aren't tracking dirty rows
+
+        struct {
+            FLibretroAudioResampler resampler; // From the core's sample rate to what the audio queue plays at
+
+            // Cores that hand us audio one sample at a time through retro_audio_sample have it collected here and written in one batch at the end of the frame
+            int16_t samples[2 * 1024];
+            unsigned num_samples;
+
+            uint64 frames_sampled; // Delivered through retro_audio_sample
+            uint64 frames_batched; // Delivered through retro_audio_sample_batch
+            uint64 sample_flushes;
+        } audio;
 
         const struct retro_hw_render_context_negotiation_interface* hw_render_context_negotiation; // @todo
         struct retro_hw_render_callback hw;
         struct retro_system_av_info av;
+        unsigned rotation; // RETRO_ENVIRONMENT_SET_ROTATION
 
         TArray<char, TInlineAllocator<512>>   save_directory,
                                             system_directory;
+
+        FLibretroCoreDescriptions descriptions; // The core's own copy. Published to the game thread whenever it changes
+        bool options_modified;                  // For RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE
     } core = { 0 };
 
 public:
-    bool &LibretroThread_bottom_left_origin = core.hw.bottom_left_origin;
-    struct retro_game_geometry &LibretroThread_geometry = core.av.geometry;
+    /** How much this core's frames matter relative to other cores when FLibretroFrameUploader is over budget. 0 means it's off screen */
+    std::atomic<float> &UploadPriority = Unreal.FrameSource.Priority;
 
-    class FLambdaRunnable* LambdaRunnable{nullptr};
+    FLibretroScheduler::FJobRef SchedulerJob;
 protected:
     // This is where the callback implementation logic is for the callbacks from the Libretro Core
     void    core_video_refresh(const void* data, unsigned width, unsigned height, unsigned pitch);
     void    core_audio_sample(int16_t left, int16_t right);
     size_t  core_audio_write(const int16_t* buf, size_t frames);
+    void    flush_audio_samples();
     int16_t core_input_state(unsigned port, unsigned device, unsigned index, unsigned id);
-    // void   core_input_poll(void);
+    void    core_input_poll();
     bool    core_environment(unsigned cmd, void* data);
+
+    // What we hand the core as its callbacks. They forward to whichever context is current on the calling thread
+    static bool      dispatch_environment(unsigned cmd, void* data);
+    static void      dispatch_video_refresh(const void* data, unsigned width, unsigned height, size_t pitch);
+    static void      dispatch_input_poll();
+    static int16_t   dispatch_input_state(unsigned port, unsigned device, unsigned index, unsigned id);
+    static void      dispatch_audio_sample(int16_t left, int16_t right);
+    static size_t    dispatch_audio_write(const int16_t* data, size_t frames);
+    static uintptr_t dispatch_get_current_framebuffer();
     
     // I read somewhere online that you technically have to load OpenGL procedures per context you make on Windows
     // I don't think it actually matters unless you're using multiple rendering devices, and even in that case it might
@@ -261,8 +448,15 @@ protected:
     bool gl_win32_interop_supported_by_driver{false};
     
     void create_window();
+    void make_gl_context_current();
     void video_configure(const struct retro_game_geometry* geom);
-
-    void load(const char* sofile);
+    void video_reallocate(const struct retro_game_geometry* geom);
+    void resize_unreal_texture(unsigned width, unsigned height);
+    void publish_video_state();
+    void publish_descriptions();
+    void notify_launch_finished();
+
+    /** @return false if the core couldn't be loaded at all, i.e. its pool copy couldn't be written. Missing symbols are still fatal */
+    bool load(const char* sofile);
     void load_game(const char* filename);
 };
\ No newline at end of file
@@ -6,11 +6,13 @@
 #include "Misc/FileHelper.h"
 #include "Components/AudioComponent.h"
 #include "GameFramework/PlayerInput.h"
+#include "Camera/PlayerCameraManager.h"
 
 #include "UnrealLibretro.h"
 #include "LibretroInputDefinitions.h"
 #include "RawAudioSoundWave.h"
 #include "LibretroContext.h"
+#include "LibretroLaunchQueue.h"
 
 #define NOT_LAUNCHED_GUARD if (!CoreInstance.IsSet()) return;
 
@@ -73,7 +75,7 @@ void ULibretroCoreInstance::GetOption(const FString& Key, FString& Value, int& I
     {
         if (CoreInstance.GetValue()->OptionDescriptions[i].Key == Key)
         {
-            Index = CoreInstance.GetValue()->OptionSelectedIndex[i].load(std::memory_order_relaxed);
+            Index = CoreInstance.GetValue()->OptionSelectedIndex[i];
             Value = CoreInstance.GetValue()->OptionDescriptions[i].Values[Index];
         }
     }
@@ -83,15 +85,7 @@ void ULibretroCoreInstance::SetOption(const FString& Key, const FString& Value)
 {
     NOT_LAUNCHED_GUARD
 
-    for (int i = 0; i < CoreInstance.GetValue()->OptionDescriptions.Num(); i++)
-    {
-        if (CoreInstance.GetValue()->OptionDescriptions[i].Key == Key)
-        {
-            int32 Index = CoreInstance.GetValue()->OptionDescriptions[i].Values.IndexOfByKey(Value);
-            CoreInstance.GetValue()->OptionSelectedIndex[i].store(Index, std::memory_order_relaxed);
-            CoreInstance.GetValue()->OptionsHaveBeenModified.store(true, std::memory_order_release);
-        }
-    }
+    CoreInstance.GetValue()->SetOption(Key, Value);
 }
 
 void ULibretroCoreInstance::Launch() 
@@ -155,6 +149,10 @@ void ULibretroCoreInstance::Launch()
                     {
                         weakThis->Shutdown();
                     }
+                    else if (weakThis->CoreInstance.IsSet())
+                    {   // So the options and controllers are there for anyone bound to OnLaunchComplete
+                        weakThis->CoreInstance.GetValue()->ConsumeDescriptions();
+                    }
 
                     weakThis->OnLaunchComplete.Broadcast(weakThis->RenderTarget,
                         weakThis->AudioBuffer, bCoreLaunchSucceeded);
@@ -173,91 +171,18 @@ void ULibretroCoreInstance::Launch()
                     File->~IFileHandle(); // must be called explicitly
                 }
             
-                // Notify delegate
-                FGraphEventRef Task = FFunctionGraphTask::CreateAndDispatchWhenReady(
-                    [weakThis, 
-                     bottom_left_origin = _CoreInstance->LibretroThread_bottom_left_origin,
-                     geometry           = _CoreInstance->LibretroThread_geometry]()
+                // Start the audio. The frame's geometry reaches us through TickComponent like any later change to it does
+                FFunctionGraphTask::CreateAndDispatchWhenReady(
+                    [weakThis]()
                     {
                         if (weakThis.IsValid())
                         {
-                            weakThis->bFrameBottomLeftOrigin = bottom_left_origin;
-                            weakThis->FrameWidth  = geometry.base_width;
-                            weakThis->FrameHeight = geometry.base_height;
-                        
-                            weakThis->OnCoreFrameBufferResize.Broadcast();
-                        
                             weakThis->AudioComponent->SetSound(weakThis->AudioBuffer);
                             weakThis->AudioComponent->Play();
                         }
                     }, TStatId(), nullptr, ENamedThreads::GameThread);
             }
         });
-    
-    // @todo theres a data race with how I assign this
-    this->CoreInstance.GetValue()->CoreEnvironmentCallback = [weakThis = MakeWeakObjectPtr(this), CoreInstance = this->CoreInstance.GetValue()](unsigned cmd, void* data)->bool
-    {
-        switch (cmd)
-        {
-            case RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO: {
-                FFunctionGraphTask::CreateAndDispatchWhenReady(
-                    [weakThis,
-                     system_av_info = *(const struct retro_system_av_info*)data]()
-                    {
-                        if (weakThis.IsValid())
-                        {
-                            { // @hack to change audio playback sample-rate
-                                auto AudioQueue = static_cast<URawAudioSoundWave*>(weakThis->AudioBuffer)->AudioQueue;
-                                weakThis->AudioBuffer = NewObject<URawAudioSoundWave>();
-                                weakThis->AudioBuffer->SetSampleRate(system_av_info.timing.sample_rate);
-                                weakThis->AudioBuffer->NumChannels = 2;
-                                static_cast<URawAudioSoundWave*>(weakThis->AudioBuffer)->AudioQueue = AudioQueue;
-                                weakThis->AudioComponent->SetSound(weakThis->AudioBuffer);
-                            }
-
-                            weakThis->FrameWidth  = system_av_info.geometry.base_width;
-                            weakThis->FrameHeight = system_av_info.geometry.base_height;
-                            weakThis->OnCoreFrameBufferResize.Broadcast();
-                        }
-                    }, TStatId(), nullptr, ENamedThreads::GameThread);
-
-                return true;
-            }
-            case RETRO_ENVIRONMENT_SET_ROTATION: {
-                FFunctionGraphTask::CreateAndDispatchWhenReady(
-                    [weakThis,
-                     rotation = *(const unsigned*)data]()
-                {
-                    if (weakThis.IsValid())
-                    {
-                        weakThis->FrameRotation = rotation / 4.f;
-                        weakThis->OnCoreFrameBufferResize.Broadcast();
-                    }
-                }, TStatId(), nullptr, ENamedThreads::GameThread);
-                
-                return true;
-            }
-            case RETRO_ENVIRONMENT_SET_GEOMETRY: {
-                auto geometry = (const struct retro_game_geometry*) data;
-                    
-                FFunctionGraphTask::CreateAndDispatchWhenReady(
-                    [weakThis,
-                     geometry = *(const struct retro_game_geometry*)data]()
-                {
-                    if (weakThis.IsValid())
-                    {
-                        weakThis->FrameWidth  = geometry.base_width;
-                        weakThis->FrameHeight = geometry.base_height;
-                        weakThis->OnCoreFrameBufferResize.Broadcast();
-                    }
-                }, TStatId(), nullptr, ENamedThreads::GameThread);
-                
-                return true;
-            }
-        }
-
-        return false;
-    };
 }
 
 void ULibretroCoreInstance::Pause(bool ShouldPause)
@@ -335,24 +260,180 @@ void ULibretroCoreInstance::SetInputDigital(int Port, bool Pressed, ERetroDevice
 {
     NOT_LAUNCHED_GUARD
 
-    CoreInstance.GetValue()->EnqueueTask([=, CoreInstance = CoreInstance.GetValue()](auto)
-    {
-        CoreInstance->InputState[Port][Input] = Pressed;
-    });
+    LastInputTime = GetWorld()->GetTimeSeconds();
+
+    CoreInstance.GetValue()->InputState[Port][Input] = Pressed;
+    CoreInstance.GetValue()->PublishInputState();
 }
 
 void ULibretroCoreInstance::SetInputAnalog(int Port, int _16BitSignedInteger, ERetroDeviceID Input)
 {
     NOT_LAUNCHED_GUARD
 
-    CoreInstance.GetValue()->EnqueueTask([=, CoreInstance = CoreInstance.GetValue()](auto)
+    LastInputTime = GetWorld()->GetTimeSeconds();
+
+    CoreInstance.GetValue()->InputState[Port][Input] = _16BitSignedInteger;
+    CoreInstance.GetValue()->PublishInputState();
+}
+
+void ULibretroCoreInstance::SetControllerStates(const TArray<FLibretroControllerState>& States)
+{
+    NOT_LAUNCHED_GUARD
+
+    LastInputTime = GetWorld()->GetTimeSeconds();
+
+    auto ToInt16 = [](int32 Value) { return (int16_t)FMath::Clamp(Value, (int32)MIN_int16, (int32)MAX_int16); };
+
+    for (int Port = 0; Port < FMath::Min(States.Num(), PortCount); Port++)
+    {
+        const FLibretroControllerState& State = States[Port];
+        FLibretroInputState& InputState = CoreInstance.GetValue()->InputState[Port];
+
+        for (int Button = to_integral(ERetroDeviceID::JoypadB); Button <= to_integral(ERetroDeviceID::JoypadR3); Button++)
+        {
+            InputState[Button] = (State.Buttons >> Button) & 1;
+        }
+
+        InputState[ERetroDeviceID::AnalogLeftX]  = ToInt16(State.LeftX);
+        InputState[ERetroDeviceID::AnalogLeftY]  = ToInt16(State.LeftY);
+        InputState[ERetroDeviceID::AnalogRightX] = ToInt16(State.RightX);
+        InputState[ERetroDeviceID::AnalogRightY] = ToInt16(State.RightY);
+        InputState[ERetroDeviceID::AnalogL2]     = ToInt16(State.L2);
+        InputState[ERetroDeviceID::AnalogR2]     = ToInt16(State.R2);
+    }
+
+    CoreInstance.GetValue()->PublishInputState(); // Once for all of them
+}
+
+FLibretroAudioStats ULibretroCoreInstance::GetAudioStats() const
+{
+    FLibretroAudioStats Stats;
+
+    // The sound wave holds its own reference to the queue so this stays valid even while the core is shutting down
+    auto RawAudioBuffer = Cast<URawAudioSoundWave>(AudioBuffer);
+    if (!CoreInstance.IsSet() || !RawAudioBuffer || !RawAudioBuffer->AudioQueue.IsValid())
     {
-        CoreInstance->InputState[Port][Input] = _16BitSignedInteger;
-    });
+        return Stats;
+    }
+
+    const FLibretroAudioQueue& AudioQueue = *RawAudioBuffer->AudioQueue;
+    const float MillisecondsPerFrame = 1000.f / AudioQueue.GetSampleRate();
+
+    Stats.Underruns            = AudioQueue.GetUnderrunCount();
+    Stats.Overruns             = AudioQueue.GetOverrunCount();
+    Stats.BufferedMilliseconds = AudioQueue.GetBufferedFrames() * MillisecondsPerFrame;
+    Stats.TargetMilliseconds   = AudioQueue.GetTargetFrames()   * MillisecondsPerFrame;
+
+    return Stats;
+}
+
+FLibretroFramePacingStats ULibretroCoreInstance::GetFramePacingStats() const
+{
+    FLibretroFramePacingStats Stats;
+
+    if (!CoreInstance.IsSet() || CoreInstance.GetValue()->CoreState.load(std::memory_order_acquire) == FLibretroContext::ECoreState::Starting)
+    {
+        return Stats;
+    }
+
+    const FLibretroFramePacer& FramePacer = CoreInstance.GetValue()->FramePacer;
+    FramePacer.GetFrameTimeHistogram(Stats.FrameTimeHistogram);
+    Stats.BucketMilliseconds      = FLibretroFramePacer::HistogramBucketSeconds * 1000.0;
+    Stats.TargetFrameMilliseconds = FramePacer.GetFrameSeconds() * 1000.0;
+    Stats.ScheduleResets          = FramePacer.GetScheduleResetCount();
+
+    return Stats;
+}
+
+FLibretroLaunchStats ULibretroCoreInstance::GetLaunchStats()
+{
+    const FLibretroLaunchQueue& LaunchQueue = FLibretroLaunchQueue::Get();
+
+    FLibretroLaunchStats Stats;
+    Stats.QueueDepth            = LaunchQueue.GetQueueDepth();
+    Stats.LaunchesInFlight      = LaunchQueue.GetLaunchesInFlight();
+    Stats.LaunchesFinished      = LaunchQueue.GetLaunchesFinished();
+    Stats.MaxQueuedMilliseconds = LaunchQueue.GetMaxQueuedSeconds() * 1000.0;
+
+    if (Stats.LaunchesFinished > 0)
+    {
+        Stats.AverageQueuedMilliseconds  = LaunchQueue.GetTotalQueuedSeconds()  * 1000.0 / Stats.LaunchesFinished;
+        Stats.AverageLoadingMilliseconds = LaunchQueue.GetTotalLoadingSeconds() * 1000.0 / Stats.LaunchesFinished;
+    }
+
+    return Stats;
+}
+
+float ULibretroCoreInstance::ComputeUploadPriority() const
+{
+    const float InteractionBonus = 1.f; // Always ahead of anything that's only on screen since screen size tops out at 1
+    const bool  bBeingPlayed     =    KeyboardInputSourcePlayerController
+                                   || GetWorld()->GetTimeSeconds() - LastInputTime < 2.0;
+
+    const AActor* Owner = GetOwner();
+    if (!Owner || !Owner->WasRecentlyRendered())
+    {
+        return bBeingPlayed ? InteractionBonus : 0.f;
+    }
+
+    return ComputeScreenSize() + (bBeingPlayed ? InteractionBonus : 0.f);
+}
+
+float ULibretroCoreInstance::ComputeLaunchPriority() const
+{
+    // Unlike uploads we can't leave out everything that isn't on screen since while the level is loading nothing has been rendered yet
+    const float OnScreenBonus = 1.f;
+
+    const AActor* Owner = GetOwner();
+    if (!Owner)
+    {
+        return 0.f;
+    }
+
+    return ComputeScreenSize() + (Owner->WasRecentlyRendered() ? OnScreenBonus : 0.f);
+}
+
+float ULibretroCoreInstance::ComputeScreenSize() const
+{
+    const AActor* Owner = GetOwner();
+    const USceneComponent* Root = Owner ? Owner->GetRootComponent() : nullptr;
+    if (!Root)
+    {
+        return 1.f;
+    }
+
+    float ClosestDistance = TNumericLimits<float>::Max();
+    for (auto Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+    {
+        const APlayerController* PlayerController = Iterator->Get();
+        if (PlayerController && PlayerController->IsLocalController() && PlayerController->PlayerCameraManager)
+        {
+            ClosestDistance = FMath::Min<float>(ClosestDistance, FVector::Dist(PlayerController->PlayerCameraManager->GetCameraLocation(), Root->Bounds.Origin));
+        }
+    }
+
+    return FMath::Clamp<float>(Root->Bounds.SphereRadius / FMath::Max(ClosestDistance, 1.f), 0.01f, 1.f);
 }
 
 void ULibretroCoreInstance::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
+    if (CoreInstance.IsSet())
+    {
+        CoreInstance.GetValue()->UploadPriority.store(ComputeUploadPriority(), std::memory_order_relaxed);
+        CoreInstance.GetValue()->ConsumeDescriptions();
+
+        // However many times the core changed its output since last tick we only pick up where it ended up and broadcast once
+        if (const FLibretroVideoState* VideoState = CoreInstance.GetValue()->ConsumeVideoState())
+        {
+            bFrameBottomLeftOrigin = VideoState->bBottomLeftOrigin;
+            FrameWidth    = VideoState->BaseWidth;
+            FrameHeight   = VideoState->BaseHeight;
+            FrameRotation = VideoState->Rotation / 4.f;
+
+            OnCoreFrameBufferResize.Broadcast();
+        }
+    }
+
     if (   CoreInstance.IsSet()
         && KeyboardInputSourcePlayerController)
     {
@@ -0,0 +1,238 @@
+#include "LibretroCoreLibrary.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+
+#include "UnrealLibretro.h" // For Libretro debug log category
+
+#if PLATFORM_LINUX || PLATFORM_ANDROID
+#include <dlfcn.h>
+#endif
+
+#if PLATFORM_ANDROID
+#include <android/dlext.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#endif
+
+FLibretroCoreLibrary& FLibretroCoreLibrary::Get()
+{
+    static FLibretroCoreLibrary CoreLibrary;
+    return CoreLibrary;
+}
+
+void* FLibretroCoreLibrary::Load(const FString& CorePath)
+{
+#if PLATFORM_LINUX
+    // A new namespace gets its own copy of everything the core links against as well, so it's a completely fresh instance
+    if (void* Handle = dlmopen(LM_ID_NEWLM, TCHAR_TO_UTF8(*CorePath), RTLD_NOW | RTLD_LOCAL))
+    {
+        return Handle;
+    }
+
+    UE_LOG(Libretro, Log, TEXT("Couldn't load '%s' into a new namespace so a copy will be loaded instead: %s"), *CorePath, UTF8_TO_TCHAR(dlerror()));
+#elif PLATFORM_ANDROID
+    if (void* Handle = LoadFromMemoryFile(CorePath))
+    {
+        return Handle;
+    }
+#endif
+
+    return LoadPooledCopy(CorePath);
+}
+
+void FLibretroCoreLibrary::Free(void* Handle)
+{
+    FPlatformProcess::FreeDllHandle(Handle);
+
+    FScopeLock ScopeLock(&Lock);
+
+    TPair<FString, FString> Copy;
+    if (LoadedCopies.RemoveAndCopyValue(Handle, Copy))
+    {
+        Pools.FindChecked(Copy.Key).FreeCopies.Push(Copy.Value);
+    }
+}
+
+void* FLibretroCoreLibrary::LoadPooledCopy(const FString& CorePath)
+{
+    IPlatformFile& PlatformFile = IPlatformFile::GetPlatformPhysical();
+    const FString PoolDirectory = GetPoolDirectory(CorePath);
+
+    FString CopyPath;
+    {
+        FScopeLock ScopeLock(&Lock);
+
+        FPool* Pool = Pools.Find(PoolDirectory);
+        if (!Pool)
+        {   // Whatever copies are already there are from previous runs
+            Pool = &Pools.Add(PoolDirectory);
+
+            TArray<FString> Copies;
+            IFileManager::Get().FindFiles(Copies, *(PoolDirectory / TEXT("*.") + FPaths::GetExtension(CorePath)), true, false);
+            for (const FString& Copy : Copies)
+            {
+                Pool->FreeCopies.Push(PoolDirectory / Copy);
+            }
+        }
+
+        if (Pool->FreeCopies.Num() > 0)
+        {
+            CopyPath = Pool->FreeCopies.Pop();
+        }
+        else
+        {
+            do
+            {
+                CopyPath = PoolDirectory / FString::Printf(TEXT("%d.%s"), Pool->NextCopyIndex++, *FPaths::GetExtension(CorePath));
+            }
+            while (PlatformFile.FileExists(*CopyPath));
+        }
+    }
+
+    if (!PlatformFile.FileExists(*CopyPath))
+    {   // Copied under another name first so if we're interrupted there's never a partial copy in the pool
+        const FString PartialCopyPath = CopyPath + TEXT(".partial");
+
+        PlatformFile.CreateDirectoryTree(*PoolDirectory);
+        if (!PlatformFile.CopyFile(*PartialCopyPath, *CorePath) || !PlatformFile.MoveFile(*CopyPath, *PartialCopyPath))
+        {
+            UE_LOG(Libretro, Warning, TEXT("Failed to copy '%s' to '%s'. Is the disk full?"), *CorePath, *CopyPath);
+            PlatformFile.DeleteFile(*PartialCopyPath);
+            return nullptr; // The name isn't handed back to the pool since there's no copy behind it. The next one just gets a new name
+        }
+    }
+
+    void* Handle = FPlatformProcess::GetDllHandle(*CopyPath);
+
+    FScopeLock ScopeLock(&Lock);
+    if (Handle)
+    {
+        LoadedCopies.Add(Handle, { PoolDirectory, CopyPath });
+    }
+    else
+    {
+        Pools.FindChecked(PoolDirectory).FreeCopies.Push(CopyPath);
+    }
+
+    return Handle;
+}
+
+FString FLibretroCoreLibrary::GetPoolDirectory(const FString& CorePath)
+{
+    IPlatformFile& PlatformFile = IPlatformFile::GetPlatformPhysical();
+
+    // Checking the size and timestamp is cheap so we only rehash if the core looks like it changed
+    const FString Version = FString::Printf(TEXT("%s|%lld|%s"), *CorePath, PlatformFile.FileSize(*CorePath), *PlatformFile.GetTimeStamp(*CorePath).ToString());
+    {
+        FScopeLock ScopeLock(&Lock);
+        if (const FString* PoolDirectory = PoolDirectories.Find(Version))
+        {
+            return *PoolDirectory;
+        }
+    }
+
+    const FString CoresDirectory = IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(
+#if PLATFORM_ANDROID
+        // On Android .so's have to be in your private application directory to be loaded
+        *FString::Printf(TEXT("/data/data/%s/files/LibretroCores"), *FAndroidPlatformProcess::GetGameBundleId())
+#else
+        *(FPaths::ProjectSavedDir() / TEXT("LibretroCores"))
+#endif
+    );
+
+    const FString CoreName = FPaths::GetBaseFilename(CorePath);
+    const FString Hash     = LexToString(FMD5Hash::HashFile(*CorePath));
+    const FString PoolDirectory = CoresDirectory / FString::Printf(TEXT("%s-%s"), *CoreName, *Hash);
+
+    // Pools for older versions of this core are dead weight now. If another process still has one loaded it'll just fail to delete
+    TArray<FString> CorePools;
+    IFileManager::Get().FindFiles(CorePools, *(CoresDirectory / CoreName + TEXT("-*")), false, true);
+    for (const FString& CorePool : CorePools)
+    {
+        const FString PoolHash = CorePool.RightChop(CoreName.Len() + 1);
+        if (PoolHash.Len() == Hash.Len() && !PoolHash.Contains(TEXT("-")) && PoolHash != Hash)
+        {
+            IFileManager::Get().DeleteDirectory(*(CoresDirectory / CorePool), false, true);
+        }
+    }
+
+    FScopeLock ScopeLock(&Lock);
+    PoolDirectories.Add(Version, PoolDirectory);
+
+    return PoolDirectory;
+}
+
+#if PLATFORM_ANDROID
+void* FLibretroCoreLibrary::LoadFromMemoryFile(const FString& CorePath)
+{
+    // Looked up at runtime since older API levels than we might be built against don't have it
+    using android_dlopen_ext_t = void* (*)(const char*, int, const android_dlextinfo*);
+    static const android_dlopen_ext_t android_dlopen_ext_ptr = (android_dlopen_ext_t)dlsym(RTLD_DEFAULT, "android_dlopen_ext");
+    if (!android_dlopen_ext_ptr)
+    {
+        return nullptr;
+    }
+
+    int MemoryFile;
+    {
+        FScopeLock ScopeLock(&Lock);
+
+        if (const int* ExistingMemoryFile = MemoryFiles.Find(CorePath))
+        {
+            MemoryFile = *ExistingMemoryFile;
+        }
+        else
+        {
+            TArray<uint8> CoreBinary;
+            if (!FFileHelper::LoadFileToArray(CoreBinary, *CorePath))
+            {
+                return nullptr;
+            }
+
+            MemoryFile = (int)syscall(__NR_memfd_create, TCHAR_TO_UTF8(*FPaths::GetCleanFilename(CorePath)), MFD_CLOEXEC);
+            if (MemoryFile < 0)
+            {
+                UE_LOG(Libretro, Log, TEXT("Couldn't create a memfd for '%s' so a copy will be loaded instead"), *CorePath);
+                return nullptr;
+            }
+
+            for (int64 Written = 0; Written < CoreBinary.Num();)
+            {
+                const ssize_t Result = write(MemoryFile, CoreBinary.GetData() + Written, CoreBinary.Num() - Written);
+                if (Result <= 0)
+                {
+                    close(MemoryFile);
+                    return nullptr;
+                }
+
+                Written += Result;
+            }
+
+            MemoryFiles.Add(CorePath, MemoryFile);
+        }
+    }
+
+    // Force loading skips the check for whether something with the same inode is loaded already which is what makes each load a fresh instance.
+    // The name has a slash in it so it isn't matched against the sonames of whatever is loaded already either
+    android_dlextinfo ExtInfo = {};
+    ExtInfo.flags      = ANDROID_DLEXT_USE_LIBRARY_FD | ANDROID_DLEXT_FORCE_LOAD;
+    ExtInfo.library_fd = MemoryFile;
+
+    void* Handle = android_dlopen_ext_ptr(TCHAR_TO_UTF8(*(TEXT("memfd/") + FPaths::GetCleanFilename(CorePath))), RTLD_NOW | RTLD_LOCAL, &ExtInfo);
+    if (!Handle)
+    {
+        UE_LOG(Libretro, Log, TEXT("Couldn't load '%s' from memory so a copy will be loaded instead: %s"), *CorePath, UTF8_TO_TCHAR(dlerror()));
+    }
+
+    return Handle;
+}
+#endif
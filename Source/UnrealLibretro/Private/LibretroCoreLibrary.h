@@ -0,0 +1,52 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Loads instances of libretro cores that don't share any globals with each other
+ *
+ * Loading the same dynamic library twice just hands back the one that's already loaded, so every core instance needs a library
+ * the OS thinks is a different one. It also can't be the original since the editor loads that to query core settings. We used to
+ * copy the whole core to a new file every launch which is slow for big cores. Now how we get a fresh instance depends on the platform:
+ *
+ * Linux:   dlmopen into a new link map namespace straight from the original. glibc only has 16 namespaces so past that we use the pool below
+ * Android: The core is read into a memfd once, then android_dlopen_ext force loads a fresh instance out of it every time
+ * Others:  A pool of copies on disk per core keyed by a hash of the core's contents. A copy goes back in the pool when its instance is
+ *          freed and the pool survives restarts, so copying only happens when more instances of a core are running than ever before
+ *
+ * Any thread.
+ */
+class FLibretroCoreLibrary
+{
+public:
+    static FLibretroCoreLibrary& Get();
+
+    /** @return Handle for FPlatformProcess::GetDllExport or nullptr if the core couldn't be loaded */
+    void* Load(const FString& CorePath);
+
+    /** Unloads a handle from Load */
+    void Free(void* Handle);
+
+protected:
+    void* LoadPooledCopy(const FString& CorePath);
+
+    /** @return Where copies of this version of the core go. Hashes the core the first time it's asked about a version */
+    FString GetPoolDirectory(const FString& CorePath);
+
+    struct FPool
+    {
+        TArray<FString> FreeCopies;
+        int32 NextCopyIndex{0};
+    };
+
+    FCriticalSection Lock;
+    TMap<FString, FString> PoolDirectories; // Core path, size, and timestamp to pool directory. So each version of a core is only hashed once
+    TMap<FString, FPool>   Pools;           // Pool directory to its copies
+    TMap<void*, TPair<FString, FString>> LoadedCopies; // Handles to the pool directory and copy they were loaded from
+
+#if PLATFORM_ANDROID
+    void* LoadFromMemoryFile(const FString& CorePath);
+
+    TMap<FString, int> MemoryFiles; // Core path to a memfd with its contents. Kept open until exit
+#endif
+};
@@ -0,0 +1,135 @@
+#include "LibretroDirtyRows.h"
+
+void FLibretroDirtyRows::Initialize(unsigned MaxWidth, unsigned MaxHeight, unsigned MaxBytesPerPixel)
+{
+    check(!PreviousFrame);
+
+    WordsPerFrame = (MaxHeight + 63) / 64;
+    History.SetNumZeroed(HistoryLength * WordsPerFrame);
+    Scratch.SetNumZeroed(WordsPerFrame);
+    PreviousFrame = (uint8*)FMemory::Malloc((SIZE_T)MaxWidth * MaxHeight * MaxBytesPerPixel, PLATFORM_CACHE_LINE_SIZE);
+}
+
+void FLibretroDirtyRows::Free()
+{
+    FMemory::Free(PreviousFrame);
+    PreviousFrame = nullptr;
+    PreviousWidth = PreviousHeight = PreviousBytesPerPixel = 0; // So the next frame after reinitializing counts as entirely changed
+    History.Empty();
+    Scratch.Empty();
+}
+
+uint64 FLibretroDirtyRows::Update(const void* Data, unsigned Width, unsigned Height, size_t Pitch, unsigned BytesPerPixel)
+{
+    check(PreviousFrame && Height <= (unsigned)WordsPerFrame * 64);
+
+    uint64* ChangedRows = RowsOf(++Sequence);
+    FMemory::Memzero(ChangedRows, WordsPerFrame * sizeof(uint64));
+
+    // If the geometry changed comparing rows doesn't mean anything so we just take the whole frame
+    const bool bEverythingChanged =    Width         != PreviousWidth
+                                    || Height        != PreviousHeight
+                                    || BytesPerPixel != PreviousBytesPerPixel;
+
+    const SIZE_T RowBytes = (SIZE_T)Width * BytesPerPixel;
+    for (unsigned y = 0; y < Height; y++)
+    {
+        const uint8* Row         = (const uint8*)Data + y * Pitch;
+              uint8* PreviousRow = PreviousFrame      + y * RowBytes;
+
+        // memcmp is already vectorized by every CRT we ship on and bails at the first difference which is usually early
+        if (bEverythingChanged || FMemory::Memcmp(Row, PreviousRow, RowBytes) != 0)
+        {
+            FMemory::Memcpy(PreviousRow, Row, RowBytes);
+            ChangedRows[y / 64] |= 1ull << (y % 64);
+        }
+    }
+
+    PreviousWidth         = Width;
+    PreviousHeight        = Height;
+    PreviousBytesPerPixel = BytesPerPixel;
+
+    return Sequence;
+}
+
+bool FLibretroDirtyRows::UnionSince(uint64 Since)
+{
+    if (Since == 0 || Sequence - Since >= HistoryLength)
+    {
+        return false;
+    }
+
+    FMemory::Memzero(Scratch.GetData(), WordsPerFrame * sizeof(uint64));
+    for (uint64 FrameSequence = Since + 1; FrameSequence <= Sequence; FrameSequence++)
+    {
+        const uint64* ChangedRows = RowsOf(FrameSequence);
+        for (int32 i = 0; i < WordsPerFrame; i++)
+        {
+            Scratch[i] |= ChangedRows[i];
+        }
+    }
+
+    return true;
+}
+
+void FLibretroDirtyRows::ForEachChangedRun(uint64 Since, TFunctionRef<void(unsigned Y, unsigned Height)> Visitor)
+{
+    if (!UnionSince(Since))
+    {
+        Visitor(0, PreviousHeight);
+        return;
+    }
+
+    auto IsChanged = [this](unsigned y) { return (Scratch[y / 64] >> (y % 64)) & 1; };
+
+    unsigned y = 0;
+    while (y < PreviousHeight)
+    {
+        if (!IsChanged(y))
+        {
+            // Skip to the next word if the rest of this one is clean
+            y = (Scratch[y / 64] >> (y % 64)) ? y + 1 : (y / 64 + 1) * 64;
+            continue;
+        }
+
+        const unsigned Start = y;
+        while (y < PreviousHeight && IsChanged(y))
+        {
+            y++;
+        }
+
+        Visitor(Start, y - Start);
+    }
+}
+
+int32 FLibretroDirtyRows::GetChangedRegions(uint64 Since, FLibretroFrame::FRegion (&OutRegions)[FLibretroFrame::MaxDirtyRegions])
+{
+    TArray<FLibretroFrame::FRegion, TInlineAllocator<32>> Runs;
+    ForEachChangedRun(Since, [&](unsigned Y, unsigned Height) { Runs.Add({ Y, Height }); });
+
+    // Every region is its own RHI update so we trade uploading a few clean rows for fewer of them. Close the smallest gaps first
+    while (Runs.Num() > FLibretroFrame::MaxDirtyRegions)
+    {
+        int32 SmallestGapIndex = 0;
+        unsigned SmallestGap = MAX_uint32;
+        for (int32 i = 0; i < Runs.Num() - 1; i++)
+        {
+            const unsigned Gap = Runs[i + 1].Y - (Runs[i].Y + Runs[i].Height);
+            if (Gap < SmallestGap)
+            {
+                SmallestGap = Gap;
+                SmallestGapIndex = i;
+            }
+        }
+
+        Runs[SmallestGapIndex].Height = Runs[SmallestGapIndex + 1].Y + Runs[SmallestGapIndex + 1].Height - Runs[SmallestGapIndex].Y;
+        Runs.RemoveAt(SmallestGapIndex + 1);
+    }
+
+    for (int32 i = 0; i < Runs.Num(); i++)
+    {
+        OutRegions[i] = Runs[i];
+    }
+
+    return Runs.Num();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "LibretroFrameUploader.h"
+
+/**
+ * Remembers which scanlines changed in each of the last HistoryLength frames a software rendered core sent us
+ *
+ * Lots of 2D games redraw the same thing over and over (menus, attract screens, static backgrounds) so rather than
+ * converting and uploading whole frames we compare each row against the previous frame and only touch what changed.
+ * Since frames sit in a triple buffer and can be dropped, we keep a short history so we can answer "what changed since frame N"
+ * for whatever frame a buffer or the texture currently holds.
+ */
+class FLibretroDirtyRows
+{
+public:
+    static constexpr uint64 HistoryLength = 64;
+
+    void Initialize(unsigned MaxWidth, unsigned MaxHeight, unsigned MaxBytesPerPixel);
+    void Free();
+
+    /**
+     * Compares the frame against the previous one and records the rows that changed
+     *
+     * @return The sequence number of this frame. Starts at 1
+     */
+    uint64 Update(const void* Data, unsigned Width, unsigned Height, size_t Pitch, unsigned BytesPerPixel);
+
+    /** Calls Visitor for every run of rows that changed after frame Since up to and including the latest one */
+    void ForEachChangedRun(uint64 Since, TFunctionRef<void(unsigned Y, unsigned Height)> Visitor);
+
+    /**
+     * Same as ForEachChangedRun except neighbouring runs are merged until they fit in FLibretroFrame::MaxDirtyRegions
+     *
+     * @return The number of regions written. 0 means nothing changed
+     */
+    int32 GetChangedRegions(uint64 Since, FLibretroFrame::FRegion (&OutRegions)[FLibretroFrame::MaxDirtyRegions]);
+
+    uint64 GetSequence() const { return Sequence; }
+
+protected:
+    // Fills Scratch with the union of the changed rows. Returns false if we don't remember that far back so everything has to be considered changed
+    bool UnionSince(uint64 Since);
+
+    uint64* RowsOf(uint64 FrameSequence) { return History.GetData() + (FrameSequence % HistoryLength) * WordsPerFrame; }
+
+    uint8* PreviousFrame{nullptr}; // Tightly packed copy of the last frame in the core's pixel format
+    unsigned PreviousWidth{0};
+    unsigned PreviousHeight{0};
+    unsigned PreviousBytesPerPixel{0};
+
+    uint64 Sequence{0};
+    int32 WordsPerFrame{0};
+    TArray<uint64> History; // HistoryLength bitsets of WordsPerFrame words each. Bit set means the row changed in that frame
+    TArray<uint64> Scratch;
+};
@@ -0,0 +1,85 @@
+#include "LibretroFramePacer.h"
+
+#include "HAL/PlatformTime.h"
+
+FLibretroFramePacer::FLibretroFramePacer()
+    : SecondsPerCycle(FPlatformTime::GetSecondsPerCycle64())
+{
+    for (auto& Bucket : FrameTimeHistogram)
+    {
+        Bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void FLibretroFramePacer::Configure(uint32 InMaxCatchUpFrames)
+{
+    MaxCatchUpFrames = InMaxCatchUpFrames;
+}
+
+void FLibretroFramePacer::SetFramesPerSecond(double FramesPerSecond)
+{
+    check(FramesPerSecond > 0.0);
+
+    const uint64 Now = FPlatformTime::Cycles64();
+    if (CyclesPerFrame == 0.0)
+    {
+        LastFrameStart = Now;
+        StartSchedule(Now);
+    }
+    else
+    {   // Rebase on the deadline we were already headed for so changing rates doesn't cost us a frame
+        StartSchedule(ScheduleStart + (uint64)(FramesScheduled * CyclesPerFrame));
+    }
+
+    CyclesPerFrame = 1.0 / (FramesPerSecond * SecondsPerCycle);
+    FrameSeconds.store(1.0 / FramesPerSecond, std::memory_order_relaxed);
+}
+
+void FLibretroFramePacer::StartSchedule(uint64 Now)
+{
+    ScheduleStart   = Now;
+    FramesScheduled = 0;
+}
+
+void FLibretroFramePacer::Restart()
+{
+    const uint64 Now = FPlatformTime::Cycles64();
+    LastFrameStart = Now;
+    StartSchedule(Now);
+}
+
+void FLibretroFramePacer::BeginFrame()
+{
+    const uint64 Now = FPlatformTime::Cycles64();
+
+    const int32 Bucket = FMath::Min((int32)((Now - LastFrameStart) * SecondsPerCycle / HistogramBucketSeconds), NumHistogramBuckets - 1);
+    FrameTimeHistogram[Bucket].fetch_add(1, std::memory_order_relaxed);
+    LastFrameStart = Now;
+}
+
+uint64 FLibretroFramePacer::ScheduleNextFrame()
+{
+    check(CyclesPerFrame > 0.0);
+
+    // Computed from the start of the schedule every time rather than accumulated frame by frame, that way rounding can't drift us
+    const uint64 Deadline = ScheduleStart + (uint64)(++FramesScheduled * CyclesPerFrame);
+
+    const uint64 Now = FPlatformTime::Cycles64();
+    if (Now > Deadline && Now - Deadline > MaxCatchUpFrames * CyclesPerFrame)
+    {   // We're too far behind. Running a burst of frames to catch up would be more jarring than just picking up from here
+        StartSchedule(Now);
+        ScheduleResets.fetch_add(1, std::memory_order_relaxed);
+        return Now;
+    }
+
+    return Deadline;
+}
+
+void FLibretroFramePacer::GetFrameTimeHistogram(TArray<int32>& OutHistogram) const
+{
+    OutHistogram.SetNumUninitialized(NumHistogramBuckets);
+    for (int32 i = 0; i < NumHistogramBuckets; i++)
+    {
+        OutHistogram[i] = FrameTimeHistogram[i].load(std::memory_order_relaxed);
+    }
+}
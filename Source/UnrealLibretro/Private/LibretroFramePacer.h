@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Standard Template Library https://docs.unrealengine.com/en-US/Programming/Development/CodingStandard/#useofstandardlibraries
+#include <atomic>
+
+/**
+ * Decides when each of a core's frames is due
+ *
+ * Every frame has an absolute deadline measured from when the schedule started, so however late any one frame runs, the error
+ * doesn't add up over time. If the core falls behind its deadlines come due back to back until it catches up. If it falls further
+ * behind than we're willing to catch up on, the schedule starts over from now instead. FLibretroScheduler does the actual waiting.
+ *
+ * Whichever worker is running the core drives it. The stats can be read from any thread.
+ */
+class FLibretroFramePacer
+{
+public:
+    static constexpr int32  NumHistogramBuckets    = 128;
+    static constexpr double HistogramBucketSeconds = 0.0005; // So the histogram covers 0-64ms. The last bucket also counts anything longer
+
+    FLibretroFramePacer();
+
+    /** @param MaxCatchUpFrames How many frames behind the core can fall before we give up catching up. 0 means never catch up */
+    void Configure(uint32 MaxCatchUpFrames);
+
+    /** Call when the core's frame rate changes. The new rate takes over from the next deadline */
+    void SetFramesPerSecond(double FramesPerSecond);
+
+    /** Starts the schedule over from now. For when the core hasn't been running for reasons of its own, like being paused */
+    void Restart();
+
+    /** Call as each frame starts */
+    void BeginFrame();
+
+    /** @return When the next frame is due in FPlatformTime::Cycles64 */
+    uint64 ScheduleNextFrame();
+
+    void   GetFrameTimeHistogram(TArray<int32>& OutHistogram) const;
+    double GetFrameSeconds() const { return FrameSeconds.load(std::memory_order_relaxed); }
+    uint64 GetScheduleResetCount() const { return ScheduleResets.load(std::memory_order_relaxed); }
+
+protected:
+    void StartSchedule(uint64 Now);
+
+    double SecondsPerCycle;
+    uint32 MaxCatchUpFrames{1};
+
+    double CyclesPerFrame{0.0};
+    uint64 ScheduleStart{0};   // Cycles64 when frame 0 of the schedule was due
+    uint64 FramesScheduled{0}; // Since ScheduleStart
+    uint64 LastFrameStart{0};
+
+    // Only written by the worker running the core
+    std::atomic<double> FrameSeconds{0.0};
+    std::atomic<uint64> ScheduleResets{0}; // Times the core fell too far behind and the schedule started over
+    std::atomic<uint32> FrameTimeHistogram[NumHistogramBuckets];
+};
@@ -0,0 +1,199 @@
+#include "LibretroFrameUploader.h"
+
+#include "Misc/CoreDelegates.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "Runtime/Launch/Resources/Version.h"
+
+#include "LibretroContext.h" // For STATGROUP_UnrealLibretro
+#include "LibretroSettings.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frames Uploaded"), STAT_LibretroFramesUploaded, STATGROUP_UnrealLibretro);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frame Uploads Deferred"), STAT_LibretroFrameUploadsDeferred, STATGROUP_UnrealLibretro);
+DECLARE_MEMORY_STAT(TEXT("Frame Bytes Uploaded"), STAT_LibretroFrameBytesUploaded, STATGROUP_UnrealLibretro);
+
+FLibretroFrameUploader& FLibretroFrameUploader::Get()
+{
+    static FLibretroFrameUploader Uploader;
+    return Uploader;
+}
+
+void FLibretroFrameUploader::Startup()
+{
+    BeginFrameHandle = FCoreDelegates::OnBeginFrameRT.AddRaw(this, &FLibretroFrameUploader::UploadPendingFrames);
+}
+
+void FLibretroFrameUploader::Shutdown()
+{
+    FCoreDelegates::OnBeginFrameRT.Remove(BeginFrameHandle);
+}
+
+uint32 FLibretroFrameUploader::Register(FLibretroFrameSource* Source, TLibretroMailbox<FLibretroFrame>* Mailbox)
+{
+    const uint32 Id = NextId.fetch_add(1, std::memory_order_relaxed);
+
+    ENQUEUE_RENDER_COMMAND(LibretroRegisterFrameUpload)([this, Id, Source, Mailbox](FRHICommandListImmediate& RHICmdList)
+        {
+            NumRecords++;
+            RHICmdList.EnqueueLambda([this, Id, Source, Mailbox](FRHICommandList&)
+                {
+                    Records.Add(FRecord{ Id, nullptr, Source, Mailbox, 0, true });
+                });
+        });
+
+    return Id;
+}
+
+template<typename FunctionType>
+void FLibretroFrameUploader::EnqueueRecordUpdate(uint32 Id, FunctionType&& Function)
+{
+    ENQUEUE_RENDER_COMMAND(LibretroUpdateFrameUpload)([this, Id, Function = MoveTemp(Function)](FRHICommandListImmediate& RHICmdList) mutable
+        {
+            RHICmdList.EnqueueLambda([this, Id, Function = MoveTemp(Function)](FRHICommandList&)
+                {
+                    for (FRecord& Record : Records)
+                    {
+                        if (Record.Id == Id)
+                        {
+                            Function(Record);
+                        }
+                    }
+                });
+        });
+}
+
+void FLibretroFrameUploader::SetTexture(uint32 Id, FTexture2DRHIRef Texture)
+{
+    EnqueueRecordUpdate(Id, [Texture](FRecord& Record)
+        {
+            Record.Texture = Texture;
+            Record.bNeedsFullUpload = true;
+            Record.Source->UploadedSequence.store(0, std::memory_order_relaxed); // The new texture doesn't have anything in it yet
+        });
+}
+
+void FLibretroFrameUploader::SetMailbox(uint32 Id, TLibretroMailbox<FLibretroFrame>* Mailbox)
+{
+    EnqueueRecordUpdate(Id, [Mailbox](FRecord& Record)
+        {
+            Record.Mailbox = Mailbox;
+        });
+}
+
+void FLibretroFrameUploader::Unregister(uint32 Id)
+{
+    ENQUEUE_RENDER_COMMAND(LibretroUnregisterFrameUpload)([this, Id](FRHICommandListImmediate& RHICmdList)
+        {
+            NumRecords--;
+            RHICmdList.EnqueueLambda([this, Id](FRHICommandList&)
+                {
+                    Records.RemoveAllSwap([Id](const FRecord& Record) { return Record.Id == Id; });
+                });
+        });
+}
+
+void FLibretroFrameUploader::UploadPendingFrames()
+{
+    check(IsInRenderingThread());
+
+    if (NumRecords == 0)
+    {
+        return;
+    }
+
+    const ULibretroSettings* Settings = GetDefault<ULibretroSettings>();
+    const int64  BudgetBytes             = 1024ll * Settings->UploadBudgetKilobytesPerFrame;
+    const uint32 OffscreenUploadInterval = Settings->OffscreenUploadInterval;
+
+    FRHICommandListExecutor::GetImmediateCommandList().EnqueueLambda([this, BudgetBytes, OffscreenUploadInterval](FRHICommandList& RHICmdList)
+        {
+            DECLARE_SCOPE_CYCLE_COUNTER(TEXT("UploadFramesToRHI"), STAT_LibretroUploadFramesToRHI, STATGROUP_UnrealLibretro);
+
+            // Figure out who wants an upload and how badly
+            Candidates.Reset();
+            for (FRecord& Record : Records)
+            {
+                Record.FramesSinceUpload++;
+
+                if (!Record.Texture.IsValid() || !Record.Mailbox->HasPending())
+                {
+                    continue;
+                }
+
+                const bool bOffscreen = Record.Source->Priority.load(std::memory_order_relaxed) <= 0.f;
+                if (bOffscreen && (OffscreenUploadInterval == 0 || Record.FramesSinceUpload < OffscreenUploadInterval))
+                {
+                    INC_DWORD_STAT(STAT_LibretroFrameUploadsDeferred);
+                    continue;
+                }
+
+                Candidates.Add(&Record);
+            }
+
+            if (BudgetBytes > 0 && Candidates.Num() > 1)
+            {
+                auto EffectivePriority = [](const FRecord& Record)
+                {
+                    // Off screen cores that made it this far have waited out their interval so they just go last
+                    return FMath::Max(Record.Source->Priority.load(std::memory_order_relaxed), KINDA_SMALL_NUMBER) * Record.FramesSinceUpload;
+                };
+
+                Candidates.Sort([&](const FRecord& A, const FRecord& B) { return EffectivePriority(A) > EffectivePriority(B); });
+            }
+
+            int64 BytesUploaded = 0;
+            for (FRecord* Record : Candidates)
+            {
+                // We always upload at least one frame so a budget smaller than a single frame doesn't freeze everything
+                if (BudgetBytes > 0 && BytesUploaded > 0 && BytesUploaded >= BudgetBytes)
+                {
+                    INC_DWORD_STAT(STAT_LibretroFrameUploadsDeferred);
+                    continue;
+                }
+
+                const FLibretroFrame* Frame = Record->Mailbox->Acquire();
+                check(Frame); // Only we consume from the mailbox so HasPending can't have changed
+
+                // This clamps for the few frames between a core presenting something bigger and its texture being resized. An out of bounds write here takes down the GPU driver
+                const FIntVector Extent = Record->Texture->GetSizeXYZ();
+                const uint32 Width  = FMath::Min<uint32>(Frame->Width,  Extent.X);
+                const uint32 Height = FMath::Min<uint32>(Frame->Height, Extent.Y);
+
+                // Buffers always hold a whole frame so we can always fall back to uploading all of it
+                const FLibretroFrame::FRegion WholeFrame = { 0, Frame->Height };
+                const bool bWholeFrame = Record->bNeedsFullUpload;
+                Record->bNeedsFullUpload = false;
+
+                for (int32 i = 0; i < (bWholeFrame ? 1 : Frame->NumDirtyRegions); i++)
+                {
+                    const FLibretroFrame::FRegion& Dirty = bWholeFrame ? WholeFrame : Frame->DirtyRegions[i];
+                    if (Dirty.Y >= Height)
+                    {
+                        continue;
+                    }
+
+                    // The source pointer below is already offset to the region so SrcX and SrcY are 0. Some RHIs offset by them as well
+                    const FUpdateTextureRegion2D Region(0, Dirty.Y, 0, 0, Width, FMath::Min(Dirty.Height, Height - Dirty.Y));
+
+                    GDynamicRHI->RHIUpdateTexture2D(
+#if    ENGINE_MAJOR_VERSION == 5 \
+    && ENGINE_MINOR_VERSION >= 2
+                        RHICmdList,
+#endif
+                        Record->Texture.GetReference(),
+                        0, // MipIndex
+                        Region,
+                        Frame->Pitch,
+                        (uint8*)Frame->Buffer + (SIZE_T)Frame->Pitch * Dirty.Y); // The source data is expected to start at the region's origin
+
+                    BytesUploaded += (int64)Frame->Pitch * Region.Height;
+                }
+
+                Record->Source->UploadedSequence.store(Frame->Sequence, std::memory_order_release);
+                Record->FramesSinceUpload = 0;
+                INC_DWORD_STAT(STAT_LibretroFramesUploaded);
+            }
+
+            SET_MEMORY_STAT(STAT_LibretroFrameBytesUploaded, BytesUploaded);
+        });
+}
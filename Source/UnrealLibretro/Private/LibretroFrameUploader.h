@@ -0,0 +1,102 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHIResources.h"
+
+#include "LibretroMailbox.h"
+
+// Standard Template Library https://docs.unrealengine.com/en-US/Programming/Development/CodingStandard/#useofstandardlibraries
+#include <atomic>
+
+// A frame already converted to the texture's pixel format waiting to be uploaded to the RHI
+struct FLibretroFrame
+{
+    void*    Buffer{nullptr};
+    unsigned Width{0};
+    unsigned Height{0};
+    unsigned Pitch{0};
+
+    uint64 Sequence{0}; // Which frame from the core the buffer holds. 0 means it hasn't been written to yet
+
+    // The rows that differ from what's already in the texture. Unless we're tracking dirty rows this is just the whole frame
+    struct FRegion
+    {
+        unsigned Y;
+        unsigned Height;
+    };
+    static constexpr int32 MaxDirtyRegions = 4;
+    FRegion DirtyRegions[MaxDirtyRegions];
+    int32   NumDirtyRegions{0};
+};
+
+// What the uploader reports back to a core and vice versa. Unlike the mailbox this lives as long as the core
+struct FLibretroFrameSource
+{
+    std::atomic<float>  Priority{1.f};       // Higher is uploaded first, 0 means off screen. Written by the game thread
+    std::atomic<uint64> UploadedSequence{0}; // Sequence of the frame that's in the texture. Written by the RHI thread
+};
+
+/**
+ * Uploads the newest frame of every running core to its RHI texture
+ *
+ * Rather than every core enqueuing its own render command per emulated frame, cores just publish into their mailbox and
+ * once per render frame we enqueue a single lambda on the RHI thread that walks every registered mailbox and updates
+ * the textures that have something new. Only the dirty regions of a frame are uploaded.
+ *
+ * If ULibretroSettings::UploadBudgetKilobytesPerFrame is set we only upload until the budget is spent. Cores are taken in
+ * order of the priority their ULibretroCoreInstance computes each tick, scaled up by how many frames they've been waiting
+ * so nothing on screen starves. Off screen cores (priority 0) only get a turn every OffscreenUploadInterval frames.
+ *
+ * The records are only ever touched on the RHI thread. Register and Unregister go through the render command queue
+ * like everything else so they're ordered with respect to any cleanup a caller enqueues afterwards.
+ */
+class FLibretroFrameUploader
+{
+public:
+    static FLibretroFrameUploader& Get();
+
+    /** Hooks into the render thread's begin frame. Should only be called from StartupModule */
+    void Startup();
+    void Shutdown();
+
+    /**
+     * These are safe to call from any thread
+     * 
+     * Nothing is uploaded for a registration until it's been given a texture. Since the RHI texture is usually created
+     * in a render command the easiest way to do that is to call SetTexture from a render command enqueued after it.
+     * The texture and mailbox can be swapped out whenever the core's geometry changes. The first frame after a texture
+     * swap is uploaded whole regardless of its dirty regions since the new texture starts out empty.
+     *
+     * @param Source Must outlive the registration. Freeing it in a render command enqueued after Unregister is fine
+     * @param Mailbox Same as Source except it can also be freed in a render command enqueued after SetMailbox replaces it
+     * @return Handle for the other calls
+     */
+    uint32 Register(FLibretroFrameSource* Source, TLibretroMailbox<FLibretroFrame>* Mailbox);
+    void   SetTexture(uint32 Id, FTexture2DRHIRef Texture);
+    void   SetMailbox(uint32 Id, TLibretroMailbox<FLibretroFrame>* Mailbox);
+    void   Unregister(uint32 Id);
+
+protected:
+    void UploadPendingFrames();
+
+    // Runs Function on the RHI thread after everything already in the render command queue
+    template<typename FunctionType>
+    void EnqueueRecordUpdate(uint32 Id, FunctionType&& Function);
+
+    struct FRecord
+    {
+        uint32 Id;
+        FTexture2DRHIRef Texture;
+        FLibretroFrameSource* Source;
+        TLibretroMailbox<FLibretroFrame>* Mailbox;
+        uint32 FramesSinceUpload;
+        bool bNeedsFullUpload;
+    };
+
+    TArray<FRecord> Records;     // RHI thread only
+    TArray<FRecord*> Candidates; // RHI thread only. Kept around so we don't allocate every frame
+    int32 NumRecords{0};     // Render thread only. Lets us skip enqueuing anything when no cores are running
+    std::atomic<uint32> NextId{1};
+
+    FDelegateHandle BeginFrameHandle;
+};
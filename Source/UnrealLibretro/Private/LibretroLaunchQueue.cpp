@@ -0,0 +1,80 @@
+#include "LibretroLaunchQueue.h"
+
+#include "LibretroContext.h" // For STATGROUP_UnrealLibretro
+#include "LibretroCoreInstance.h"
+#include "LibretroSettings.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Launches Queued"), STAT_LibretroLaunchesQueued, STATGROUP_UnrealLibretro);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Launches In Flight"), STAT_LibretroLaunchesInFlight, STATGROUP_UnrealLibretro);
+
+FLibretroLaunchQueue& FLibretroLaunchQueue::Get()
+{
+    static FLibretroLaunchQueue LaunchQueue;
+    return LaunchQueue;
+}
+
+void FLibretroLaunchQueue::Enqueue(FLibretroContext* Context, ULibretroCoreInstance* Instance)
+{
+    check(IsInGameThread());
+
+    Queue.Add({ Context, Instance });
+
+    AdmitLaunches();
+}
+
+void FLibretroLaunchQueue::Cancel(FLibretroContext* Context)
+{
+    check(IsInGameThread());
+
+    Queue.RemoveAll([Context](const FEntry& Entry) { return Entry.Context == Context; });
+    UpdateStats();
+}
+
+void FLibretroLaunchQueue::NotifyLaunchFinished(double QueuedSeconds, double LoadingSeconds)
+{
+    check(IsInGameThread());
+    check(LaunchesInFlight > 0);
+
+    LaunchesInFlight--;
+    LaunchesFinished++;
+    TotalQueuedSeconds  += QueuedSeconds;
+    MaxQueuedSeconds     = FMath::Max(MaxQueuedSeconds, QueuedSeconds);
+    TotalLoadingSeconds += LoadingSeconds;
+
+    AdmitLaunches();
+}
+
+void FLibretroLaunchQueue::AdmitLaunches()
+{
+    const int32 MaxConcurrentLaunches = GetDefault<ULibretroSettings>()->MaxConcurrentLaunches;
+
+    while (Queue.Num() > 0 && (MaxConcurrentLaunches <= 0 || LaunchesInFlight < MaxConcurrentLaunches))
+    {
+        // Priorities are recomputed every time since the player moves around while the level loads
+        int32 Next = 0;
+        float NextPriority = -1.f;
+        for (int32 i = 0; i < Queue.Num(); i++)
+        {
+            const float Priority = Queue[i].Instance.IsValid() ? Queue[i].Instance->ComputeLaunchPriority() : 0.f;
+            if (Priority > NextPriority)
+            {
+                Next = i;
+                NextPriority = Priority;
+            }
+        }
+
+        FLibretroContext* Context = Queue[Next].Context;
+        Queue.RemoveAt(Next);
+
+        LaunchesInFlight++;
+        Context->AdmitLaunch();
+    }
+
+    UpdateStats();
+}
+
+void FLibretroLaunchQueue::UpdateStats()
+{
+    SET_DWORD_STAT(STAT_LibretroLaunchesQueued, Queue.Num());
+    SET_DWORD_STAT(STAT_LibretroLaunchesInFlight, LaunchesInFlight);
+}
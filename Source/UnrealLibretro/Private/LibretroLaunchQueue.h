@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+
+class ULibretroCoreInstance;
+struct FLibretroContext;
+
+/**
+ * Staggers core launches so a level full of cabinets doesn't copy, load, and initialize every core at once
+ *
+ * Launching a context schedules its job right away, but the job parks before loading anything until the queue gives it its turn.
+ * At most ULibretroSettings::MaxConcurrentLaunches cores load at a time. Whenever one finishes loading, the queued one whose
+ * ULibretroCoreInstance is on screen and closest to a local player goes next, so the cabinets the player can see come up first.
+ *
+ * Game thread only.
+ */
+class FLibretroLaunchQueue
+{
+public:
+    static FLibretroLaunchQueue& Get();
+
+    /** Context's job loads the core once it's Context's turn */
+    void Enqueue(FLibretroContext* Context, ULibretroCoreInstance* Instance);
+
+    /** Gives up Context's place in the queue. Does nothing if it's already had its turn */
+    void Cancel(FLibretroContext* Context);
+
+    /** For every context Enqueue let through, once its core has loaded or failed to */
+    void NotifyLaunchFinished(double QueuedSeconds, double LoadingSeconds);
+
+    int32  GetQueueDepth()           const { return Queue.Num(); }
+    int32  GetLaunchesInFlight()     const { return LaunchesInFlight; }
+    int32  GetLaunchesFinished()     const { return LaunchesFinished; }
+    double GetTotalQueuedSeconds()   const { return TotalQueuedSeconds; }
+    double GetMaxQueuedSeconds()     const { return MaxQueuedSeconds; }
+    double GetTotalLoadingSeconds()  const { return TotalLoadingSeconds; }
+
+protected:
+    void AdmitLaunches();
+    void UpdateStats();
+
+    struct FEntry
+    {
+        FLibretroContext* Context;
+        TWeakObjectPtr<ULibretroCoreInstance> Instance; // Just for deciding who goes first
+    };
+
+    TArray<FEntry> Queue; // In the order they were enqueued so ties go to whoever's been waiting longest
+    int32 LaunchesInFlight{0};
+
+    int32  LaunchesFinished{0};
+    double TotalQueuedSeconds{0.0};
+    double MaxQueuedSeconds{0.0};
+    double TotalLoadingSeconds{0.0};
+};
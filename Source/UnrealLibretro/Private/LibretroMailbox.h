@@ -0,0 +1,86 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Standard Template Library https://docs.unrealengine.com/en-US/Programming/Development/CodingStandard/#useofstandardlibraries
+#include <atomic>
+
+/**
+ * Lock-free triple buffer that hands the newest value from one producer thread to one consumer thread
+ *
+ * There are three slots. The producer owns one it can always write into, the consumer owns the one it last acquired,
+ * and the third sits in the middle holding the most recently published value. Publishing and acquiring are a single
+ * atomic exchange with the middle slot, so neither side ever waits on the other.
+ *
+ * If the producer publishes again before the consumer got around to acquiring, the unread value is overwritten and counted as dropped.
+ */
+template<typename T>
+class TLibretroMailbox
+{
+public:
+    /** Producer: The slot to fill in before calling Publish. The consumer won't touch it until then */
+    T& GetWriteSlot() { return Slots[WriteIndex]; }
+
+    /**
+     * Producer: Hands the write slot over to the consumer and takes ownership of a free one
+     *
+     * @return true if the consumer had already taken the previous value. false means that value was dropped
+     */
+    bool Publish()
+    {
+        const uint8 Previous = Middle.exchange(WriteIndex | FreshBit, std::memory_order_acq_rel);
+        WriteIndex = Previous & IndexMask;
+
+        if (Previous & FreshBit)
+        {
+            Dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Consumer: Takes the most recently published value
+     *
+     * @return nullptr if nothing new was published since the last call. Otherwise the value stays valid until the next successful Acquire
+     */
+    T* Acquire()
+    {
+        // Only the consumer ever clears the fresh bit so if we see it here the exchange below is guaranteed to get a fresh slot
+        if (!(Middle.load(std::memory_order_relaxed) & FreshBit))
+        {
+            return nullptr;
+        }
+
+        ReadIndex = Middle.exchange(ReadIndex, std::memory_order_acq_rel) & IndexMask;
+        return &Slots[ReadIndex];
+    }
+
+    /** Consumer: true if Acquire would return a value */
+    bool HasPending() const { return (Middle.load(std::memory_order_relaxed) & FreshBit) != 0; }
+
+    /** Number of published values that were overwritten before the consumer acquired them */
+    uint64 GetDroppedCount() const { return Dropped.load(std::memory_order_relaxed); }
+
+    /**
+     * For allocating and freeing whatever the slots own
+     *
+     * @note Only safe while neither the producer nor the consumer are using the mailbox
+     */
+    T& GetSlot(int32 Index) { return Slots[Index]; }
+    static constexpr int32 NumSlots = 3;
+
+private:
+    static constexpr uint8 IndexMask = 0b011;
+    static constexpr uint8 FreshBit  = 0b100;
+
+    T Slots[NumSlots];
+
+    // The producer and consumer indices are each only touched by one thread so they get their own cache lines to avoid false sharing
+    alignas(PLATFORM_CACHE_LINE_SIZE) uint8 WriteIndex{0};
+    alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint8> Middle{1};
+    alignas(PLATFORM_CACHE_LINE_SIZE) uint8 ReadIndex{2};
+
+    std::atomic<uint64> Dropped{0};
+};
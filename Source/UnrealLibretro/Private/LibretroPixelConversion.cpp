@@ -0,0 +1,431 @@
+#include "LibretroPixelConversion.h"
+extern "C"
+{
+#include "gfx/scaler/pixconv.h"
+}
+
+#include "UnrealLibretro.h" // For Libretro debug log category
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define LIBRETRO_PIXCONV_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define LIBRETRO_PIXCONV_X86 0
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define LIBRETRO_PIXCONV_NEON 1
+#include <arm_neon.h>
+#else
+#define LIBRETRO_PIXCONV_NEON 0
+#endif
+
+// MSVC lets you use any intrinsic regardless of /arch, clang and gcc need to be told per function
+#if LIBRETRO_PIXCONV_X86 && defined(_MSC_VER) && !defined(__clang__)
+#define LIBRETRO_TARGET_AVX2
+#elif LIBRETRO_PIXCONV_X86
+#define LIBRETRO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Channel expansion shared by every kernel below. Replicating the high bits into the low bits maps 0x1f to 0xff exactly like pixconv does
+static FORCEINLINE uint32 expand5(uint32 c) { return (c << 3) | (c >> 2); }
+static FORCEINLINE uint32 expand6(uint32 c) { return (c << 2) | (c >> 4); }
+
+enum class EPixelLayout { ARGB8888, ABGR8888 };
+
+template<EPixelLayout Layout>
+static FORCEINLINE uint32 pack_8888(uint32 r, uint32 g, uint32 b)
+{
+    return Layout == EPixelLayout::ARGB8888 ? (0xffu << 24) | (r << 16) | (g << 8) | b
+                                            : (0xffu << 24) | (b << 16) | (g << 8) | r;
+}
+
+template<EPixelLayout Layout>
+static FORCEINLINE uint32 rgb565_to_8888(uint32 col)
+{
+    return pack_8888<Layout>(expand5(col >> 11), expand6((col >> 5) & 0x3f), expand5(col & 0x1f));
+}
+
+template<EPixelLayout Layout>
+static FORCEINLINE uint32 rgb1555_to_8888(uint32 col)
+{
+    return pack_8888<Layout>(expand5((col >> 10) & 0x1f), expand5((col >> 5) & 0x1f), expand5(col & 0x1f));
+}
+
+#if !LIBRETRO_PIXCONV_X86
+// pixconv doesn't have a 0RGB1555 to ABGR8888 converter so this is the portable fallback for it
+static void conv_0rgb1555_abgr8888_scalar(void* output_, const void* input_, int width, int height, int out_stride, int in_stride)
+{
+    const uint16* input  = (const uint16*)input_;
+          uint32* output = (uint32*)output_;
+
+    for (int h = 0; h < height; h++, output += out_stride >> 2, input += in_stride >> 1)
+    {
+        for (int w = 0; w < width; w++)
+        {
+            output[w] = rgb1555_to_8888<EPixelLayout::ABGR8888>(input[w]);
+        }
+    }
+}
+#endif
+
+#if LIBRETRO_PIXCONV_X86
+/**
+ * SSE2 kernels
+ *
+ * x86-64 always has SSE2 so these are the baseline. pixconv covers most of this already, but it has no 0RGB1555 to ABGR8888 converter
+ * and its SSE2 path for RGB565 to ABGR8888 doesn't actually swap red and blue
+ */
+template<EPixelLayout Layout>
+static FORCEINLINE void store_rgb_sse2(uint32* output, __m128i r, __m128i g, __m128i b)
+{
+    const __m128i alpha = _mm_set1_epi16((int16)0xff00);
+
+    const __m128i lo = Layout == EPixelLayout::ARGB8888 ? _mm_or_si128(b, _mm_slli_epi16(g, 8)) : _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    const __m128i hi = Layout == EPixelLayout::ARGB8888 ? _mm_or_si128(r, alpha)                : _mm_or_si128(b, alpha);
+
+    _mm_storeu_si128((__m128i*)(output + 0), _mm_unpacklo_epi16(lo, hi));
+    _mm_storeu_si128((__m128i*)(output + 4), _mm_unpackhi_epi16(lo, hi));
+}
+
+template<EPixelLayout Layout>
+static void conv_rgb565_sse2(void* output_, const void* input_, int width, int height, int out_stride, int in_stride)
+{
+    const uint16* input  = (const uint16*)input_;
+          uint32* output = (uint32*)output_;
+
+    const __m128i mask_f8 = _mm_set1_epi16(0xf8);
+    const __m128i mask_fc = _mm_set1_epi16(0xfc);
+    const __m128i mask_07 = _mm_set1_epi16(0x07);
+    const __m128i mask_03 = _mm_set1_epi16(0x03);
+
+    for (int h = 0; h < height; h++, output += out_stride >> 2, input += in_stride >> 1)
+    {
+        int w = 0;
+        for (; w + 8 <= width; w += 8)
+        {
+            const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+            const __m128i r = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(in, 8), mask_f8),               _mm_srli_epi16(in, 13));
+            const __m128i g = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(in, 3), mask_fc), _mm_and_si128(_mm_srli_epi16(in,  9), mask_03));
+            const __m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(in, 3), mask_f8), _mm_and_si128(_mm_srli_epi16(in,  2), mask_07));
+
+            store_rgb_sse2<Layout>(output + w, r, g, b);
+        }
+
+        for (; w < width; w++)
+        {
+            output[w] = rgb565_to_8888<Layout>(input[w]);
+        }
+    }
+}
+
+template<EPixelLayout Layout>
+static void conv_0rgb1555_sse2(void* output_, const void* input_, int width, int height, int out_stride, int in_stride)
+{
+    const uint16* input  = (const uint16*)input_;
+          uint32* output = (uint32*)output_;
+
+    const __m128i mask_f8 = _mm_set1_epi16(0xf8);
+    const __m128i mask_07 = _mm_set1_epi16(0x07);
+
+    for (int h = 0; h < height; h++, output += out_stride >> 2, input += in_stride >> 1)
+    {
+        int w = 0;
+        for (; w + 8 <= width; w += 8)
+        {
+            const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+            const __m128i r = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(in, 7), mask_f8), _mm_and_si128(_mm_srli_epi16(in, 12), mask_07));
+            const __m128i g = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(in, 2), mask_f8), _mm_and_si128(_mm_srli_epi16(in,  7), mask_07));
+            const __m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(in, 3), mask_f8), _mm_and_si128(_mm_srli_epi16(in,  2), mask_07));
+
+            store_rgb_sse2<Layout>(output + w, r, g, b);
+        }
+
+        for (; w < width; w++)
+        {
+            output[w] = rgb1555_to_8888<Layout>(input[w]);
+        }
+    }
+}
+
+/**
+ * AVX2 kernels
+ *
+ * Each iteration converts 16 pixels. The channels are computed in 16 bit lanes, paired up into 32 bit pixels with unpack
+ * and then put back in order with permute2x128 since the AVX2 unpacks only work within 128 bit halves.
+ */
+template<EPixelLayout Layout>
+LIBRETRO_TARGET_AVX2 static FORCEINLINE void store_rgb_avx2(uint32* output, __m256i r, __m256i g, __m256i b)
+{
+    const __m256i alpha = _mm256_set1_epi16((int16)0xff00);
+
+    const __m256i lo = Layout == EPixelLayout::ARGB8888 ? _mm256_or_si256(b, _mm256_slli_epi16(g, 8)) : _mm256_or_si256(r, _mm256_slli_epi16(g, 8));
+    const __m256i hi = Layout == EPixelLayout::ARGB8888 ? _mm256_or_si256(r, alpha)                   : _mm256_or_si256(b, alpha);
+
+    const __m256i pixels_0_3_8_11  = _mm256_unpacklo_epi16(lo, hi);
+    const __m256i pixels_4_7_12_15 = _mm256_unpackhi_epi16(lo, hi);
+    _mm256_storeu_si256((__m256i*)(output + 0), _mm256_permute2x128_si256(pixels_0_3_8_11, pixels_4_7_12_15, 0x20));
+    _mm256_storeu_si256((__m256i*)(output + 8), _mm256_permute2x128_si256(pixels_0_3_8_11, pixels_4_7_12_15, 0x31));
+}
+
+template<EPixelLayout Layout>
+LIBRETRO_TARGET_AVX2 static void conv_rgb565_avx2(void* output_, const void* input_, int width, int height, int out_stride, int in_stride)
+{
+    const uint16* input  = (const uint16*)input_;
+          uint32* output = (uint32*)output_;
+
+    const __m256i mask_f8 = _mm256_set1_epi16(0xf8);
+    const __m256i mask_fc = _mm256_set1_epi16(0xfc);
+    const __m256i mask_07 = _mm256_set1_epi16(0x07);
+    const __m256i mask_03 = _mm256_set1_epi16(0x03);
+
+    for (int h = 0; h < height; h++, output += out_stride >> 2, input += in_stride >> 1)
+    {
+        int w = 0;
+        for (; w + 16 <= width; w += 16)
+        {
+            const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+            const __m256i r = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(in, 8), mask_f8),                  _mm256_srli_epi16(in, 13));
+            const __m256i g = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(in, 3), mask_fc), _mm256_and_si256(_mm256_srli_epi16(in,  9), mask_03));
+            const __m256i b = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi16(in, 3), mask_f8), _mm256_and_si256(_mm256_srli_epi16(in,  2), mask_07));
+
+            store_rgb_avx2<Layout>(output + w, r, g, b);
+        }
+
+        for (; w < width; w++)
+        {
+            output[w] = rgb565_to_8888<Layout>(input[w]);
+        }
+    }
+}
+
+template<EPixelLayout Layout>
+LIBRETRO_TARGET_AVX2 static void conv_0rgb1555_avx2(void* output_, const void* input_, int width, int height, int out_stride, int in_stride)
+{
+    const uint16* input  = (const uint16*)input_;
+          uint32* output = (uint32*)output_;
+
+    const __m256i mask_f8 = _mm256_set1_epi16(0xf8);
+    const __m256i mask_07 = _mm256_set1_epi16(0x07);
+
+    for (int h = 0; h < height; h++, output += out_stride >> 2, input += in_stride >> 1)
+    {
+        int w = 0;
+        for (; w + 16 <= width; w += 16)
+        {
+            const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+            const __m256i r = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(in, 7), mask_f8), _mm256_and_si256(_mm256_srli_epi16(in, 12), mask_07));
+            const __m256i g = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(in, 2), mask_f8), _mm256_and_si256(_mm256_srli_epi16(in,  7), mask_07));
+            const __m256i b = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi16(in, 3), mask_f8), _mm256_and_si256(_mm256_srli_epi16(in,  2), mask_07));
+
+            store_rgb_avx2<Layout>(output + w, r, g, b);
+        }
+
+        for (; w < width; w++)
+        {
+            output[w] = rgb1555_to_8888<Layout>(input[w]);
+        }
+    }
+}
+
+LIBRETRO_TARGET_AVX2 static void conv_argb8888_abgr8888_avx2(void* output_, const void* input_, int width, int height, int out_stride, int in_stride)
+{
+    const uint32* input  = (const uint32*)input_;
+          uint32* output = (uint32*)output_;
+
+    const __m256i swap_red_blue = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                                   2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    for (int h = 0; h < height; h++, output += out_stride >> 2, input += in_stride >> 2)
+    {
+        int w = 0;
+        for (; w + 16 <= width; w += 16)
+        {
+            const __m256i lo = _mm256_loadu_si256((const __m256i*)(input + w + 0));
+            const __m256i hi = _mm256_loadu_si256((const __m256i*)(input + w + 8));
+            _mm256_storeu_si256((__m256i*)(output + w + 0), _mm256_shuffle_epi8(lo, swap_red_blue));
+            _mm256_storeu_si256((__m256i*)(output + w + 8), _mm256_shuffle_epi8(hi, swap_red_blue));
+        }
+
+        for (; w < width; w++)
+        {
+            uint32 col = input[w];
+            output[w] = ((col << 16) & 0xff0000) | ((col >> 16) & 0xff) | (col & 0xff00ff00);
+        }
+    }
+}
+
+static bool cpu_supports_avx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    __cpuid(info, 1);
+    const bool bOSXSAVE = (info[2] & (1 << 27)) != 0;
+    const bool bAVX     = (info[2] & (1 << 28)) != 0;
+    if (!bOSXSAVE || !bAVX) return false;
+
+    // The OS also has to save the upper halves of the ymm registers on a context switch
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+#if LIBRETRO_PIXCONV_NEON
+/**
+ * NEON kernels
+ *
+ * Each iteration converts 8 pixels (16 for the swizzle). The channels are narrowed to 8 bits and written interleaved with vst4 which
+ * handles the byte ordering for us, so the only difference between the two layouts is which lane red and blue go into.
+ */
+template<EPixelLayout Layout>
+static FORCEINLINE void store_rgb_neon(uint32* output, uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+    uint8x8x4_t res;
+    res.val[0] = Layout == EPixelLayout::ARGB8888 ? b : r;
+    res.val[1] = g;
+    res.val[2] = Layout == EPixelLayout::ARGB8888 ? r : b;
+    res.val[3] = vdup_n_u8(0xff);
+    vst4_u8((uint8_t*)output, res);
+}
+
+template<EPixelLayout Layout>
+static void conv_rgb565_neon(void* output_, const void* input_, int width, int height, int out_stride, int in_stride)
+{
+    const uint16* input  = (const uint16*)input_;
+          uint32* output = (uint32*)output_;
+
+    for (int h = 0; h < height; h++, output += out_stride >> 2, input += in_stride >> 1)
+    {
+        int w = 0;
+        for (; w + 8 <= width; w += 8)
+        {
+            const uint16x8_t in = vld1q_u16(input + w);
+            const uint8x8_t r = vand_u8(vshrn_n_u16(in, 8), vdup_n_u8(0xf8));
+            const uint8x8_t g = vand_u8(vshrn_n_u16(in, 3), vdup_n_u8(0xfc));
+            const uint8x8_t b = vmovn_u16(vshlq_n_u16(in, 3));
+
+            store_rgb_neon<Layout>(output + w, vorr_u8(r, vshr_n_u8(r, 5)), vorr_u8(g, vshr_n_u8(g, 6)), vorr_u8(b, vshr_n_u8(b, 5)));
+        }
+
+        for (; w < width; w++)
+        {
+            output[w] = rgb565_to_8888<Layout>(input[w]);
+        }
+    }
+}
+
+template<EPixelLayout Layout>
+static void conv_0rgb1555_neon(void* output_, const void* input_, int width, int height, int out_stride, int in_stride)
+{
+    const uint16* input  = (const uint16*)input_;
+          uint32* output = (uint32*)output_;
+
+    for (int h = 0; h < height; h++, output += out_stride >> 2, input += in_stride >> 1)
+    {
+        int w = 0;
+        for (; w + 8 <= width; w += 8)
+        {
+            const uint16x8_t in = vld1q_u16(input + w);
+            const uint8x8_t r = vand_u8(vshrn_n_u16(in, 7), vdup_n_u8(0xf8));
+            const uint8x8_t g = vand_u8(vshrn_n_u16(in, 2), vdup_n_u8(0xf8));
+            const uint8x8_t b = vmovn_u16(vshlq_n_u16(in, 3));
+
+            store_rgb_neon<Layout>(output + w, vorr_u8(r, vshr_n_u8(r, 5)), vorr_u8(g, vshr_n_u8(g, 5)), vorr_u8(b, vshr_n_u8(b, 5)));
+        }
+
+        for (; w < width; w++)
+        {
+            output[w] = rgb1555_to_8888<Layout>(input[w]);
+        }
+    }
+}
+
+static void conv_argb8888_abgr8888_neon(void* output_, const void* input_, int width, int height, int out_stride, int in_stride)
+{
+    const uint32* input  = (const uint32*)input_;
+          uint32* output = (uint32*)output_;
+
+    for (int h = 0; h < height; h++, output += out_stride >> 2, input += in_stride >> 2)
+    {
+        int w = 0;
+        for (; w + 16 <= width; w += 16)
+        {
+            uint8x16x4_t pixels = vld4q_u8((const uint8_t*)(input + w));
+            const uint8x16_t blue = pixels.val[0];
+            pixels.val[0] = pixels.val[2];
+            pixels.val[2] = blue;
+            vst4q_u8((uint8_t*)(output + w), pixels);
+        }
+
+        for (; w < width; w++)
+        {
+            uint32 col = input[w];
+            output[w] = ((col << 16) & 0xff0000) | ((col >> 16) & 0xff) | (col & 0xff00ff00);
+        }
+    }
+}
+#endif
+
+static FLibretroPixelConversion PixelConversion =
+{
+#if LIBRETRO_PIXCONV_X86
+    conv_rgb565_argb8888,
+    conv_rgb565_sse2<EPixelLayout::ABGR8888>,
+    conv_0rgb1555_argb8888,
+    conv_0rgb1555_sse2<EPixelLayout::ABGR8888>,
+#else
+    conv_rgb565_argb8888,
+    conv_rgb565_abgr8888,
+    conv_0rgb1555_argb8888,
+    conv_0rgb1555_abgr8888_scalar,
+#endif
+    conv_argb8888_abgr8888,
+    conv_copy, // Just a memcpy per row which is already as fast as it gets
+    TEXT("pixconv"),
+};
+
+void FLibretroPixelConversion::Initialize()
+{
+#if LIBRETRO_PIXCONV_X86
+    if (cpu_supports_avx2())
+    {
+        PixelConversion.conv_rgb565_argb8888   = conv_rgb565_avx2<EPixelLayout::ARGB8888>;
+        PixelConversion.conv_rgb565_abgr8888   = conv_rgb565_avx2<EPixelLayout::ABGR8888>;
+        PixelConversion.conv_0rgb1555_argb8888 = conv_0rgb1555_avx2<EPixelLayout::ARGB8888>;
+        PixelConversion.conv_0rgb1555_abgr8888 = conv_0rgb1555_avx2<EPixelLayout::ABGR8888>;
+        PixelConversion.conv_argb8888_abgr8888 = conv_argb8888_abgr8888_avx2;
+        PixelConversion.InstructionSet = TEXT("AVX2");
+    }
+    else
+    {
+        PixelConversion.InstructionSet = TEXT("SSE2");
+    }
+#elif LIBRETRO_PIXCONV_NEON
+    // NEON is mandatory on arm64 and Unreal doesn't support armv7 devices without it so there's nothing to query
+    PixelConversion.conv_rgb565_argb8888   = conv_rgb565_neon<EPixelLayout::ARGB8888>;
+    PixelConversion.conv_rgb565_abgr8888   = conv_rgb565_neon<EPixelLayout::ABGR8888>;
+    PixelConversion.conv_0rgb1555_argb8888 = conv_0rgb1555_neon<EPixelLayout::ARGB8888>;
+    PixelConversion.conv_0rgb1555_abgr8888 = conv_0rgb1555_neon<EPixelLayout::ABGR8888>;
+    PixelConversion.conv_argb8888_abgr8888 = conv_argb8888_abgr8888_neon;
+    PixelConversion.InstructionSet = TEXT("NEON");
+#endif
+
+    UE_LOG(Libretro, Log, TEXT("Using %s pixel conversion routines"), PixelConversion.InstructionSet);
+}
+
+const FLibretroPixelConversion& FLibretroPixelConversion::Get()
+{
+    return PixelConversion;
+}
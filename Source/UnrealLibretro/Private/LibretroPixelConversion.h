@@ -0,0 +1,31 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Same signature as the converters in gfx/scaler/pixconv.h. Strides are in bytes
+typedef void (*libretro_pixel_conversion_t)(void* output, const void* input, int width, int height, int out_stride, int in_stride);
+
+/**
+ * The converters core_video_refresh uses to get a software rendered frame into the layout of Unreal's framebuffer.
+ *
+ * The vendored pixconv.c routines are SSE2 at best on x86 and mostly scalar on ARM, so we keep our own AVX2 and NEON kernels
+ * here and pick the fastest set the CPU supports once in StartupModule. After that the table is read only so it's safe to read from any thread.
+ *
+ * Naming follows pixconv: argb8888 is B,G,R,A in memory (PF_B8G8R8A8) and abgr8888 is R,G,B,A in memory (PF_R8G8B8A8)
+ */
+struct FLibretroPixelConversion
+{
+    libretro_pixel_conversion_t conv_rgb565_argb8888;
+    libretro_pixel_conversion_t conv_rgb565_abgr8888;
+    libretro_pixel_conversion_t conv_0rgb1555_argb8888;
+    libretro_pixel_conversion_t conv_0rgb1555_abgr8888;
+    libretro_pixel_conversion_t conv_argb8888_abgr8888;
+    libretro_pixel_conversion_t conv_copy;
+
+    const TCHAR* InstructionSet;
+
+    /** Should only be called from StartupModule */
+    static void Initialize();
+
+    static const FLibretroPixelConversion& Get();
+};
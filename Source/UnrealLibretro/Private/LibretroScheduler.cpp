@@ -0,0 +1,314 @@
+#include "LibretroScheduler.h"
+
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/Event.h"
+
+#include "LibretroContext.h" // For STATGROUP_UnrealLibretro
+#include "LibretroSettings.h"
+#include "UnrealLibretro.h" // For Libretro debug log category
+
+// A job has to be overdue by this much before another worker steals it, otherwise idle workers would race its own worker for it every frame
+static constexpr double StealAfterSeconds = 0.001;
+
+// How often a worker with nothing of its own to run checks whether it could help another worker out
+static constexpr uint32 StealCheckMilliseconds = 4;
+
+FLibretroScheduler& FLibretroScheduler::Get()
+{
+    static FLibretroScheduler Scheduler;
+    return Scheduler;
+}
+
+void FLibretroScheduler::StartWorkers()
+{
+    check(IsInGameThread());
+
+    auto LibretroSettings = GetDefault<ULibretroSettings>();
+
+    // We leave a core for the game thread. The render thread and audio thread mostly wait on the GPU and audio device respectively
+    const int32 NumWorkers = LibretroSettings->SchedulerThreads > 0 ? LibretroSettings->SchedulerThreads
+                                                                    : FMath::Max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads() - 1);
+
+    SpinCycles = (uint64)(FMath::Max(0.f, LibretroSettings->FramePacingSpinMilliseconds) / 1000.0 / FPlatformTime::GetSecondsPerCycle64());
+
+    for (int32 i = 0; i < NumWorkers; i++)
+    {
+        Workers.Add(MakeUnique<FWorker>(*this, i));
+    }
+
+    UE_LOG(Libretro, Log, TEXT("Started %d libretro worker threads"), NumWorkers);
+}
+
+void FLibretroScheduler::Shutdown()
+{
+    bStopping.store(true, std::memory_order_relaxed);
+
+    for (auto& Worker : Workers)
+    {
+        Worker->WakeEvent->Trigger();
+    }
+
+    Workers.Empty(); // Joins each of them
+}
+
+FLibretroScheduler::FJobRef FLibretroScheduler::Schedule(TUniqueFunction<void(FJob&)> Step)
+{
+    check(IsInGameThread());
+
+    if (Workers.Num() == 0)
+    {
+        StartWorkers();
+    }
+
+    FWorker* LeastBusy = Workers[0].Get();
+    for (auto& Worker : Workers)
+    {
+        if (Worker->NumJobs.load(std::memory_order_relaxed) < LeastBusy->NumJobs.load(std::memory_order_relaxed))
+        {
+            LeastBusy = Worker.Get();
+        }
+    }
+
+    FJobRef Job = MakeShared<FJob, ESPMode::ThreadSafe>();
+    Job->Step     = MoveTemp(Step);
+    Job->Deadline = FPlatformTime::Cycles64();
+    Job->Worker   = LeastBusy;
+
+    NumJobs.fetch_add(1, std::memory_order_relaxed);
+    LeastBusy->NumJobs.fetch_add(1, std::memory_order_relaxed);
+    LeastBusy->Push(Job);
+
+    // Everyone else might be waiting indefinitely for lack of work to steal
+    for (auto& Worker : Workers)
+    {
+        Worker->WakeEvent->Trigger();
+    }
+
+    return Job;
+}
+
+void FLibretroScheduler::Wake(const FJobRef& Job)
+{
+    // If it's running this makes sure it doesn't park, see RunJob
+    Job->bWakeRequested.store(true);
+
+    auto Expected = FJob::EState::Parked;
+    if (Job->State.compare_exchange_strong(Expected, FJob::EState::Queued))
+    {
+        Job->Deadline = FPlatformTime::Cycles64();
+        Job->Worker->Push(Job);
+        NotifyJobQueued(*Job);
+    }
+}
+
+void FLibretroScheduler::NotifyJobQueued(const FJob& Job)
+{
+    if (Job.Worker->SleepingUntil.load() > Job.Deadline)
+    {
+        Job.Worker->WakeEvent->Trigger();
+    }
+}
+
+FLibretroScheduler::FJobRef FLibretroScheduler::PopDueJob(FWorker& Thief, uint64 Now, uint64& OutNextDeadline, uint64& OutNextStealDeadline)
+{
+    OutNextDeadline      = MAX_uint64;
+    OutNextStealDeadline = MAX_uint64;
+
+    auto PopSoonest = [&](FWorker& Worker, uint64 Delay, uint64& OutDeadline) -> FJobRef
+    {
+        FScopeLock Lock(&Worker.QueueLock);
+
+        int32 Soonest = INDEX_NONE;
+        for (int32 i = 0; i < Worker.Queue.Num(); i++)
+        {
+            if (   (&Worker == &Thief || !Worker.Queue[i]->bPinned)
+                && (Soonest == INDEX_NONE || Worker.Queue[i]->Deadline < Worker.Queue[Soonest]->Deadline))
+            {
+                Soonest = i;
+            }
+        }
+
+        if (Soonest == INDEX_NONE)
+        {
+            return nullptr;
+        }
+
+        if (Worker.Queue[Soonest]->Deadline + Delay > Now)
+        {
+            OutDeadline = FMath::Min(OutDeadline, Worker.Queue[Soonest]->Deadline + Delay);
+            return nullptr;
+        }
+
+        FJobRef Job = Worker.Queue[Soonest];
+        Worker.Queue.RemoveAtSwap(Soonest);
+        return Job;
+    };
+
+    if (FJobRef Job = PopSoonest(Thief, 0, OutNextDeadline))
+    {
+        return Job;
+    }
+
+    const uint64 StealAfterCycles = (uint64)(StealAfterSeconds / FPlatformTime::GetSecondsPerCycle64());
+    for (auto& Worker : Workers)
+    {
+        if (Worker.Get() == &Thief)
+        {
+            continue;
+        }
+
+        if (FJobRef Job = PopSoonest(*Worker, StealAfterCycles, OutNextStealDeadline))
+        {
+            Job->Worker = &Thief;
+            Worker->NumJobs.fetch_sub(1, std::memory_order_relaxed);
+            Thief.NumJobs.fetch_add(1, std::memory_order_relaxed);
+            return Job;
+        }
+    }
+
+    return nullptr;
+}
+
+void FLibretroScheduler::RunJob(FWorker& Worker, FJobRef Job)
+{
+    check(Job->Worker == &Worker);
+
+    Job->State.store(FJob::EState::Running);
+    Job->bWakeRequested.store(false); // Anything that asks to wake it from here on is either seen by the step or caught below
+    Job->NextState = FJob::EState::Finished;
+
+    Job->Step(*Job);
+
+    switch (Job->NextState)
+    {
+    case FJob::EState::Queued:
+        Job->State.store(FJob::EState::Queued);
+        Worker.Push(MoveTemp(Job));
+        break;
+    case FJob::EState::Parked: {
+        Job->State.store(FJob::EState::Parked);
+
+        // Wake could have been called after the step decided to park, but before we got here, in which case it saw us as running and left it to us
+        auto Expected = FJob::EState::Parked;
+        if (Job->bWakeRequested.load() && Job->State.compare_exchange_strong(Expected, FJob::EState::Queued))
+        {
+            Job->Deadline = FPlatformTime::Cycles64();
+            Worker.Push(MoveTemp(Job));
+        }
+        break;
+    }
+    default:
+        Job->State.store(FJob::EState::Finished);
+        Job->Step = nullptr; // Release whatever it captured now rather than whenever the last reference goes away
+        Worker.NumJobs.fetch_sub(1, std::memory_order_relaxed);
+        NumJobs.fetch_sub(1, std::memory_order_relaxed);
+        break;
+    }
+}
+
+void FLibretroScheduler::FJob::RunAt(uint64 InDeadline)
+{
+    Deadline  = InDeadline;
+    NextState = EState::Queued;
+}
+
+void FLibretroScheduler::FJob::Park()
+{
+    NextState = EState::Parked;
+}
+
+FLibretroScheduler::FWorker::FWorker(FLibretroScheduler& Scheduler, int32 Index)
+    : Scheduler(Scheduler)
+{
+    WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+    Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("LibretroWorker%d"), Index), 0,
+        EThreadPriority::TPri_SlightlyBelowNormal); // See FLambdaRunnable for why this isn't any higher
+}
+
+FLibretroScheduler::FWorker::~FWorker()
+{
+    Thread->WaitForCompletion();
+    delete Thread;
+    FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+}
+
+void FLibretroScheduler::FWorker::Push(FJobRef Job)
+{
+    FScopeLock Lock(&QueueLock);
+    Queue.Add(MoveTemp(Job));
+}
+
+uint32 FLibretroScheduler::FWorker::Run()
+{
+    const double SecondsPerCycle = FPlatformTime::GetSecondsPerCycle64();
+
+    while (!Scheduler.bStopping.load(std::memory_order_relaxed))
+    {
+        // Say we might be sleeping before we look so that anything queued while we're looking still wakes us, see NotifyJobQueued
+        SleepingUntil.store(MAX_uint64);
+
+        uint64 Now = FPlatformTime::Cycles64();
+        uint64 NextDeadline;
+        uint64 NextStealDeadline;
+        if (FJobRef Job = Scheduler.PopDueJob(*this, Now, NextDeadline, NextStealDeadline))
+        {
+            SleepingUntil.store(0, std::memory_order_relaxed);
+            Scheduler.RunJob(*this, MoveTemp(Job));
+            continue;
+        }
+
+        SleepingUntil.store(NextDeadline);
+
+        DECLARE_SCOPE_CYCLE_COUNTER(TEXT("Sleep"), STAT_LibretroSleep, STATGROUP_UnrealLibretro);
+
+        // Only our own jobs are worth spinning for. Another worker's job's owner almost always gets to it first so for those we just block until it'd
+        // be worth stealing, as long as that doesn't eat into the time we'd start spinning for one of our own
+        const uint64 SpinFrom = NextDeadline - FMath::Min(NextDeadline, Scheduler.SpinCycles);
+        if (NextStealDeadline < SpinFrom)
+        {
+            uint32 WaitMilliseconds = NextStealDeadline > Now ? (uint32)FMath::CeilToInt((NextStealDeadline - Now) * SecondsPerCycle * 1000.0) : 1;
+            if (NextDeadline != MAX_uint64)
+            {
+                WaitMilliseconds = FMath::Min(WaitMilliseconds, (uint32)((SpinFrom - Now) * SecondsPerCycle * 1000.0));
+            }
+
+            if (WaitMilliseconds > 0)
+            {
+                WakeEvent->Wait(FMath::Min(WaitMilliseconds, StealCheckMilliseconds));
+                continue;
+            }
+        }
+
+        if (NextDeadline == MAX_uint64)
+        {
+            if (Scheduler.NumJobs.load(std::memory_order_relaxed) == 0)
+            {
+                WakeEvent->Wait(); // Schedule wakes everyone
+            }
+            else
+            {   // Another worker's jobs could be queued while we sleep and we'd never hear about it so we check back every so often
+                WakeEvent->Wait(StealCheckMilliseconds);
+            }
+            continue;
+        }
+
+        // Sleeping can overshoot by however long the OS's scheduler tick is so we stop sleeping early and spin the rest
+        const uint32 SleepMilliseconds = NextDeadline - Now > Scheduler.SpinCycles ? (uint32)((NextDeadline - Now - Scheduler.SpinCycles) * SecondsPerCycle * 1000.0) : 0;
+        if (SleepMilliseconds > 0)
+        {
+            WakeEvent->Wait(FMath::Min(SleepMilliseconds, StealCheckMilliseconds));
+        }
+        else
+        {
+            while (FPlatformTime::Cycles64() < NextDeadline)
+            {
+                FPlatformProcess::SleepNoStats(0.f); // Just yields the rest of our time slice
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+
+// Standard Template Library https://docs.unrealengine.com/en-US/Programming/Development/CodingStandard/#useofstandardlibraries
+#include <atomic>
+
+/**
+ * Runs every core on a fixed pool of worker threads instead of giving each one its own thread
+ *
+ * A core is a job that's stepped one frame at a time. After each step it says when it wants to run next, it parks until
+ * something wakes it, or it finishes. Each worker has its own queue and always runs whichever of its jobs is due soonest.
+ * Between jobs it sleeps until just before the next deadline and spins the rest of the way like FLibretroFramePacer used to.
+ * A worker with nothing due steals the most overdue job from another worker unless that job is pinned. Jobs that own
+ * thread local state, like an OpenGL context, pin themselves to the worker they're on.
+ *
+ * Jobs are scheduled from the game thread and can be woken from any thread. Everything else happens on the workers.
+ */
+class FLibretroScheduler
+{
+public:
+    class FWorker;
+
+    class FJob
+    {
+    public:
+        /** Run the next step once FPlatformTime::Cycles64 reaches Deadline */
+        void RunAt(uint64 Deadline);
+
+        /** Don't run again until FLibretroScheduler::Wake */
+        void Park();
+
+        /** Never move this job off the worker it's running on now */
+        void PinToCurrentWorker() { bPinned = true; }
+
+    protected:
+        friend class FLibretroScheduler;
+
+        enum class EState : uint8
+        {
+            Queued,
+            Running,
+            Parked,
+            Finished
+        };
+
+        TUniqueFunction<void(FJob&)> Step;
+        uint64 Deadline{0};
+        EState NextState{EState::Finished}; // What the step asked for. Finishing is the default so a step that returns without asking for anything ends the job
+        bool bPinned{false};
+        FWorker* Worker{nullptr}; // Whose queue it goes back into
+
+        std::atomic<EState> State{EState::Queued};
+        std::atomic<bool> bWakeRequested{false};
+    };
+
+    using FJobRef = TSharedPtr<FJob, ESPMode::ThreadSafe>;
+
+    static FLibretroScheduler& Get();
+
+    /** Joins the workers. Whatever jobs are left are abandoned */
+    void Shutdown();
+
+    /**
+     * Runs Step as soon as possible then however the step asks
+     *
+     * @return For waking the job. The job is freed once it finishes and nothing else holds on to it
+     */
+    FJobRef Schedule(TUniqueFunction<void(FJob&)> Step);
+
+    /** Runs a parked job as soon as possible. If the job is running right now and parks it'll be run again right away instead */
+    void Wake(const FJobRef& Job);
+
+    class FWorker : public FRunnable
+    {
+    public:
+        FWorker(FLibretroScheduler& Scheduler, int32 Index);
+        virtual ~FWorker();
+
+        virtual uint32 Run() override;
+
+    protected:
+        friend class FLibretroScheduler;
+
+        void Push(FJobRef Job);
+
+        FLibretroScheduler& Scheduler;
+        class FRunnableThread* Thread{nullptr};
+        class FEvent* WakeEvent{nullptr};
+
+        FCriticalSection QueueLock;
+        TArray<FJobRef> Queue; // Unordered. There are only ever a handful of jobs per worker so we just scan for the soonest
+
+        std::atomic<int32>  NumJobs{0};        // Assigned to this worker whether they're queued, running, or parked. For placing new jobs
+        std::atomic<uint64> SleepingUntil{0};  // When this worker plans to look at the queues again. 0 means it's busy
+    };
+
+protected:
+    void StartWorkers();
+
+    /**
+     * @return A due job from Thief's queue or stolen from another worker's. If there isn't one OutNextDeadline is when one of Thief's own
+     *         jobs is due and OutNextStealDeadline is when another worker's job would be overdue enough to steal
+     */
+    FJobRef PopDueJob(FWorker& Thief, uint64 Now, uint64& OutNextDeadline, uint64& OutNextStealDeadline);
+
+    void RunJob(FWorker& Worker, FJobRef Job);
+
+    /** Wakes the job's worker if it plans on sleeping past the job's deadline */
+    void NotifyJobQueued(const FJob& Job);
+
+    TArray<TUniquePtr<FWorker>> Workers;
+    std::atomic<int32> NumJobs{0}; // Across every worker. Workers don't bother waking up to look for work to steal when there's none
+    std::atomic<bool> bStopping{false};
+
+    uint64 SpinCycles{0};
+};
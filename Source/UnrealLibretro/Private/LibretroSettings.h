@@ -21,6 +21,86 @@ public:
     UPROPERTY(config, EditAnywhere, Category = Libretro)
     TMap<FString, FString> GlobalCoreOptions;
 
+    /**
+     * Caps how many kilobytes of frames are uploaded to the GPU per rendered frame across all running cores. 0 means no limit.
+     * When over budget the screens that are on screen, large on screen, or being played get their frames uploaded first and the rest wait
+     */
+    UPROPERTY(Config, EditAnywhere, Category = Performance, meta = (ClampMin = 0))
+    int32 UploadBudgetKilobytesPerFrame = 0;
+
+    /** How many rendered frames a core that's off screen waits between uploads. 0 means it isn't uploaded at all until it's visible again */
+    UPROPERTY(Config, EditAnywhere, Category = Performance, meta = (ClampMin = 0))
+    int32 OffscreenUploadInterval = 30;
+
+    /**
+     * Compare each frame from software rendered cores against the last one and only convert and upload the rows that changed.
+     * Helps a lot with 2D games that mostly sit on static screens, but costs a compare per row on games that redraw everything every frame
+     */
+    UPROPERTY(Config, EditAnywhere, Category = Performance)
+    bool bUploadOnlyChangedRows = false;
+
+    /**
+     * How many frames from hardware rendered cores can be in flight from the GPU at once. Normally only one is, adding a frame of latency.
+     * The rest give the GPU more time when it falls behind before the core has to wait on it, at the cost of a frame of latency each for as long as
+     * they stay in use. The core only waits when all of them are still in flight
+     */
+    UPROPERTY(Config, EditAnywhere, Category = Performance, meta = (ClampMin = 2, ClampMax = 4))
+    int32 HardwareReadbackDepth = 3;
+
+    /**
+     * By default every frame from a hardware rendered core is delivered in order, so after the GPU falls behind the extra latency it built up sticks around.
+     * With this on, whenever several frames have finished copying back at once only the newest is delivered and the rest are dropped, which gets back to a frame of latency right away
+     */
+    UPROPERTY(Config, EditAnywhere, Category = Performance)
+    bool bHardwareReadbackSkipToNewest = false;
+
+    /**
+     * How much audio each core buffers ahead of the audio device. Lower means less latency, but the more cores share a machine the more
+     * likely one falls behind and crackles. Can be overridden by ULibretroCoreInstance::AudioBufferMilliseconds
+     */
+    UPROPERTY(Config, EditAnywhere, Category = Audio, meta = (ClampMin = 5, ClampMax = 1000))
+    int32 AudioBufferMilliseconds = 50;
+
+    /** Raise a core's audio buffer every time it runs dry, then lower it back toward AudioBufferMilliseconds once it's been fine for a while */
+    UPROPERTY(Config, EditAnywhere, Category = Audio)
+    bool bAdaptiveAudioBuffer = false;
+
+    /** The most an adaptive audio buffer is allowed to grow to */
+    UPROPERTY(Config, EditAnywhere, Category = Audio, meta = (ClampMin = 5, ClampMax = 1000, EditCondition = "bAdaptiveAudioBuffer"))
+    int32 AdaptiveAudioBufferMaxMilliseconds = 200;
+
+    /**
+     * Most audio frames handed to the audio device each time it asks for more. 0 hands over as much as it asks for.
+     * The fewer we hand over the more often we get asked, which keeps the buffer shallower at the cost of more callbacks
+     */
+    UPROPERTY(Config, EditAnywhere, Category = Audio, meta = (ClampMin = 0))
+    int32 MaxAudioFramesPerCallback = 64;
+
+    /**
+     * How many threads run cores. Each one runs whichever of its cores' frames is due next, so you can have many more cores than threads.
+     * 0 means one for each of the CPU's hardware threads less one for the game thread
+     */
+    UPROPERTY(Config, EditAnywhere, Category = Performance, meta = (ClampMin = 0, ConfigRestartRequired = true))
+    int32 SchedulerThreads = 0;
+
+    /**
+     * How long before a frame is due the thread running it stops sleeping and spins instead. Sleeping can overshoot by however long the OS's scheduler tick is,
+     * so the higher this is the steadier the frame times, at the cost of burning a CPU for that long before every frame. 0 only sleeps
+     */
+    UPROPERTY(Config, EditAnywhere, Category = Performance, meta = (ClampMin = 0, ClampMax = 10))
+    float FramePacingSpinMilliseconds = 2.f;
+
+    /** How many frames a core can fall behind and still run frames back to back to catch up. Past that it just picks up from where it is. 0 never catches up */
+    UPROPERTY(Config, EditAnywhere, Category = Performance, meta = (ClampMin = 0))
+    int32 MaxCatchUpFrames = 1;
+
+    /**
+     * How many cores can be loading at once. The rest wait their turn with whichever are on screen and closest to the player going first.
+     * Keeps a level full of cabinets from copying and loading every core at the same time when it starts. 0 means no limit
+     */
+    UPROPERTY(Config, EditAnywhere, Category = Performance, meta = (ClampMin = 0))
+    int32 MaxConcurrentLaunches = 2;
+
     FName GetCategoryName() const override
     {
         return TEXT("Plugins");
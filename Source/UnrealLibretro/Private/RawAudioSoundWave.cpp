@@ -16,22 +16,11 @@ URawAudioSoundWave::URawAudioSoundWave( const FObjectInitializer& ObjectInitiali
 
 int32 URawAudioSoundWave::GeneratePCMData( uint8* PCMData, const int32 SamplesNeeded )
 {
-    auto SamplesIWillGive = FMath::Min(64, SamplesNeeded);
-
-    auto FramesDequeued = 0;
-    int32 AudioFrame;
-    while (FramesDequeued < SamplesIWillGive && AudioQueue->Peek(AudioFrame)) {
-        ((int32*)PCMData)[FramesDequeued] = AudioFrame;
-        AudioQueue->Dequeue();
-        FramesDequeued++;
-    }
-
-    if (SamplesIWillGive != FramesDequeued) {
-        UE_LOG(Libretro, Verbose, TEXT("Buffer overrun by %d bytes. Filling with 0 data"), 4 * (SamplesIWillGive - FramesDequeued));
-        FMemory::Memzero(PCMData+4*FramesDequeued, 4 * (SamplesIWillGive - FramesDequeued));
-    }
+    // SamplesNeeded counts interleaved samples, not stereo frames. PCMData only has room for SamplesNeeded int16's
+    // Pads with silence and keeps track of underruns
+    auto FramesIWillGive = AudioQueue->Dequeue(PCMData, SamplesNeeded / FMath::Max(NumChannels, 1));
     
-    return 4 * SamplesIWillGive; // Note: THIS FUNCTION EXPECTS BYTES READ TO BE RETURNED NOT SAMPLES READ I HAVE BEEN BURNED BY THIS TOO MANY TIMES
+    return 4 * FramesIWillGive; // Note: THIS FUNCTION EXPECTS BYTES READ TO BE RETURNED NOT SAMPLES READ I HAVE BEEN BURNED BY THIS TOO MANY TIMES
                                  //       Also what we return here implicitly affects some things:
                                  //           - returning 0 implies stop playing
                                  //           - The smaller the number the higher the frequency we are polled at
@@ -1,7 +1,8 @@
 #pragma once
 #include "CoreMinimal.h"
 #include "Sound/SoundWave.h"
-#include "Containers/CircularQueue.h"
+
+#include "LibretroAudioQueue.h"
 
 #include "RawAudioSoundWave.generated.h"
 
@@ -42,7 +43,7 @@ public:
 
     /** Holds queued audio samples. */
     typedef uint32 libretro_frame;
-    TSharedPtr<TCircularQueue<int32>, ESPMode::ThreadSafe> AudioQueue; // TCircularQueue is thread safe and lock free in single producer single consumer scenarios
+    TSharedPtr<FLibretroAudioQueue, ESPMode::ThreadSafe> AudioQueue; // Lock free with one producer and one consumer, we're the consumer
 
     bool bSetupDelegates;
 };
@@ -4,6 +4,13 @@
 #include "Modules/ModuleManager.h"
 
 #include "LibretroSettings.h"
+#include "LibretroPixelConversion.h"
+#include "LibretroFrameUploader.h"
+#include "LibretroScheduler.h"
+
+#if PLATFORM_LINUX
+#include "GL/egl_definitions.h"
+#endif
 
 DEFINE_LOG_CATEGORY(Libretro)
 
@@ -15,6 +22,10 @@ PFN_wglCreateContext _wglCreateContext;
 PFN_wglDeleteContext _wglDeleteContext;
 PFN_wglMakeCurrent _wglMakeCurrent;
 PFN_wglGetProcAddress _wglGetProcAddress;
+#elif PLATFORM_LINUX
+void* EGLDLL;
+#define DEFINE_EGL_PROCEDURES(Type,Func) Type Func = nullptr;
+ENUM_EGL_PROCEDURES(DEFINE_EGL_PROCEDURES);
 #endif
 
 void FUnrealLibretroModule::StartupModule()
@@ -25,6 +36,9 @@ void FUnrealLibretroModule::StartupModule()
 #define LIBRETRO_MODULE_LOAD_ERROR(msg) FMessageDialog::Open(EAppMsgType::Ok, LOCTEXT("LibretroError", msg LIBRETRO_NOTE)); \
                                         UE_LOG(Libretro, Fatal, TEXT(msg LIBRETRO_NOTE));
 
+    FLibretroPixelConversion::Initialize();
+    FLibretroFrameUploader::Get().Startup();
+
 #if PLATFORM_WINDOWS
     FString BaseDir = IPluginManager::Get().FindPlugin("UnrealLibretro")->GetBaseDir();
     RedistDirectory = FPaths::Combine(*BaseDir, TEXT("Binaries/Win64/ThirdParty/libretro/"));
@@ -46,11 +60,34 @@ void FUnrealLibretroModule::StartupModule()
     wc.hInstance = GetModuleHandle(NULL);
     wc.lpszClassName = TEXT("my_opengl_class");
     RegisterClass(&wc);
+#elif PLATFORM_LINUX
+    // Not fatal unlike opengl32.dll on Windows since plenty of headless machines we run on don't have libEGL and software rendered cores don't need it
+    EGLDLL = FPlatformProcess::GetDllHandle(TEXT("libEGL.so.1"));
+    if (EGLDLL)
+    {
+        bool bFoundAllEntryPoints = true;
+        #define GET_EGL_PROCEDURES(Type,Func) Func = (Type)FPlatformProcess::GetDllExport(EGLDLL, TEXT(#Func)); bFoundAllEntryPoints &= Func != nullptr;
+        ENUM_EGL_PROCEDURES(GET_EGL_PROCEDURES);
+
+        if (!bFoundAllEntryPoints)
+        {
+            UE_LOG(Libretro, Warning, TEXT("libEGL.so.1 is missing EGL 1.4 entry points. Hardware rendered cores won't work"));
+            FPlatformProcess::FreeDllHandle(EGLDLL);
+            EGLDLL = nullptr;
+        }
+    }
+    else
+    {
+        UE_LOG(Libretro, Warning, TEXT("Couldn't load libEGL.so.1. Hardware rendered cores won't work. Installing Mesa (libegl1 and libgl1-mesa-dri) will fix this even on machines without a GPU"));
+    }
 #endif
 }
 
 void FUnrealLibretroModule::ShutdownModule()
 {
+    FLibretroFrameUploader::Get().Shutdown();
+    FLibretroScheduler::Get().Shutdown();
+
     // @todo For now I skip resource cleanup. It could be added back if I added isReadyForFinishDestroy(bool) to ULibretroCoreInstance
     // in conjunction with waiting for the FLibretroContext to destruct since UE uses the outstanding UObjects from this module visible through
     // the reflection system (UProperty, etc)  to determine when it is safe to shutdown this module.
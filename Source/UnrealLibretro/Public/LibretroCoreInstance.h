@@ -19,6 +19,110 @@ struct FLibretroControllerDescriptions
     const FLibretroControllerDescription& operator[](int Port) const { return ControllerDescription[Port]; }
 };
 
+/** Everything on a controller at once. For setting a whole port's input in one go with SetControllerStates */
+USTRUCT(BlueprintType)
+struct FLibretroControllerState
+{
+    GENERATED_BODY()
+
+    /** Bit i is whether ERetroDeviceID i is pressed. So bit 0 is JoypadB through bit 15 which is JoypadR3 */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Libretro")
+    int32 Buttons = 0;
+
+    /** The analog values are int16 ranged. Anything outside of that is clamped */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Libretro")
+    int32 LeftX = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Libretro")
+    int32 LeftY = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Libretro")
+    int32 RightX = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Libretro")
+    int32 RightY = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Libretro")
+    int32 L2 = 0;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Libretro")
+    int32 R2 = 0;
+};
+
+/** How a core's audio has been keeping up with the audio device */
+USTRUCT(BlueprintType)
+struct FLibretroAudioStats
+{
+    GENERATED_BODY()
+
+    /** Times the audio device ran out of audio and played silence */
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    int64 Underruns = 0;
+
+    /** Times the core produced more audio than there was room for so some of it was dropped */
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    int64 Overruns = 0;
+
+    /** How much audio is waiting to be played right now */
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    float BufferedMilliseconds = 0.f;
+
+    /** How much audio we're trying to keep buffered. Only changes if the buffer is adaptive */
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    float TargetMilliseconds = 0.f;
+};
+
+/** How steadily a core's frames have been paced since it launched */
+USTRUCT(BlueprintType)
+struct FLibretroFramePacingStats
+{
+    GENERATED_BODY()
+
+    /** Frame counts by how long each frame took. Bucket i counts frames that took between i and i + 1 times BucketMilliseconds. The last bucket also counts anything longer */
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    TArray<int32> FrameTimeHistogram;
+
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    float BucketMilliseconds = 0.f;
+
+    /** How long a frame should take at the core's frame rate */
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    float TargetFrameMilliseconds = 0.f;
+
+    /** Times the core fell further behind than LibretroSettings' MaxCatchUpFrames and gave up catching up */
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    int64 ScheduleResets = 0;
+};
+
+/** How launches have been getting through the launch queue across every core instance. See LibretroSettings' MaxConcurrentLaunches */
+USTRUCT(BlueprintType)
+struct FLibretroLaunchStats
+{
+    GENERATED_BODY()
+
+    /** Launches waiting for their turn right now */
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    int32 QueueDepth = 0;
+
+    /** Cores loading right now */
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    int32 LaunchesInFlight = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    int32 LaunchesFinished = 0;
+
+    /** How long finished launches waited for their turn on average */
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    float AverageQueuedMilliseconds = 0.f;
+
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    float MaxQueuedMilliseconds = 0.f;
+
+    /** How long finished launches took to load once it was their turn on average */
+    UPROPERTY(BlueprintReadOnly, Category = "Libretro")
+    float AverageLoadingMilliseconds = 0.f;
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnLaunchComplete, const class UTextureRenderTarget2D*, LibretroFramebuffer, const class USoundWave*, AudioBuffer, const bool, bSuccess);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnCoreFramebufferResize);
 
@@ -57,6 +161,7 @@ public:
     /**
      * @brief Starts the launch process on a background thread
      * After the emulator has been successfully launched it will issue the event "On Core Is Ready".
+     * Only so many cores load at once, see LibretroSettings' MaxConcurrentLaunches, so it might have to wait its turn first.
      * 
      * **Note:** This will implicitly call Shutdown if a Core is already running
      * 
@@ -151,6 +256,27 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Libretro|IneffectiveBeforeLaunch")
     void SetInputAnalog(int Port, int _16BitSignedInteger, ERetroDeviceID Input);
 
+    /**
+     * @brief Sets every button and analog input of several ports at once
+     * 
+     * The index of each state is the port it's for. Ports past the end of States are left alone.
+     * The core is guaranteed to see all of it in the same frame, unlike a series of SetInputDigital calls which it could catch halfway through
+     */
+    UFUNCTION(BlueprintCallable, Category = "Libretro|IneffectiveBeforeLaunch")
+    void SetControllerStates(const TArray<FLibretroControllerState>& States);
+
+    /** Useful for tuning AudioBufferMilliseconds. Returns all zeros until the core has started producing audio */
+    UFUNCTION(BlueprintPure, Category = "Libretro|IneffectiveBeforeLaunchComplete")
+    FLibretroAudioStats GetAudioStats() const;
+
+    /** For checking how much frame times jitter. Returns an empty histogram until the core has launched */
+    UFUNCTION(BlueprintPure, Category = "Libretro|IneffectiveBeforeLaunchComplete")
+    FLibretroFramePacingStats GetFramePacingStats() const;
+
+    /** For tuning MaxConcurrentLaunches. Covers every core instance not just this one */
+    UFUNCTION(BlueprintPure, Category = "Libretro")
+    static FLibretroLaunchStats GetLaunchStats();
+
     /** 
      * @brief Where the Libretro Core's frame is drawn
      * 
@@ -207,6 +333,10 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Libretro, AdvancedDisplay)
     FString SRAMPath = "Default.srm";
 
+    /** How much audio to buffer ahead of the audio device. 0 uses the project setting. Takes effect on the next Launch */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Libretro, AdvancedDisplay, meta = (ClampMin = 0, ClampMax = 1000))
+    int32 AudioBufferMilliseconds = 0;
+
 
     /** These properties are with respect to how the frame is drawn by the Libretro Core in the framebuffer it's provided */
     UPROPERTY(BlueprintReadOnly, Category = Libretro)
@@ -232,6 +362,17 @@ protected:
 
     bool Paused = false;
 
+    // Used to decide whose frames get uploaded first when over ULibretroSettings::UploadBudgetKilobytesPerFrame
+    float ComputeUploadPriority() const;
+
+    // Used to decide who launches first when over ULibretroSettings::MaxConcurrentLaunches
+    float ComputeLaunchPriority() const;
+    friend class FLibretroLaunchQueue;
+
+    // Roughly the fraction of the view the screen takes up from the closest local player
+    float ComputeScreenSize() const;
+    double LastInputTime{-1.0e9};
+
     UPROPERTY()
     USoundWave* AudioBuffer;
 };
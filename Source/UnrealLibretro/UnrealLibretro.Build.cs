@@ -26,6 +26,10 @@ public class UnrealLibretro : ModuleRules
 			RuntimeDependencies.Add("$(PluginDir)/MyCores/Android/armeabi-v7a/*");
 			RuntimeDependencies.Add("$(PluginDir)/MyCores/Android/arm64-v8a/*");
 		}
+		else if (Target.Platform.Equals(UnrealTargetPlatform.Linux))
+		{
+			RuntimeDependencies.Add("$(PluginDir)/MyCores/Linux/x86_64/*");
+		}
 
 		PublicDependencyModuleNames.AddRange(
 			new string[]